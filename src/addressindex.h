@@ -57,6 +57,11 @@ struct CAddressUnspentKey {
         txhash.SetNull();
         index = 0;
     }
+
+    friend bool operator==(const CAddressUnspentKey& a, const CAddressUnspentKey& b)
+    {
+        return a.type == b.type && a.hashBytes == b.hashBytes && a.txhash == b.txhash && a.index == b.index;
+    }
 };
 
 struct CAddressUnspentValue {
@@ -164,6 +169,12 @@ struct CAddressIndexKey {
         index = 0;
         spending = false;
     }
+
+    friend bool operator==(const CAddressIndexKey& a, const CAddressIndexKey& b)
+    {
+        return a.type == b.type && a.hashBytes == b.hashBytes && a.blockHeight == b.blockHeight && a.txindex == b.txindex &&
+               a.txhash == b.txhash && a.index == b.index && a.spending == b.spending;
+    }
 };
 
 struct CAddressIndexIteratorKey {
@@ -249,6 +260,46 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/** Running totals of the address index entries of one address */
+struct CAddressBalance {
+    CAmount balance;
+    CAmount received;
+    uint32_t txCount;
+    int firstHeight;
+    int lastHeight;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(txCount);
+        READWRITE(firstHeight);
+        READWRITE(lastHeight);
+    }
+
+    CAddressBalance()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        balance = 0;
+        received = 0;
+        txCount = 0;
+        firstHeight = -1;
+        lastHeight = -1;
+    }
+
+    bool IsNull() const
+    {
+        return (txCount == 0);
+    }
+};
+
 struct CMempoolAddressDelta {
     int64_t time;
     CAmount amount;
@@ -198,6 +198,16 @@ template void base_uint<256>::SetHex(const char*);
 template void base_uint<256>::SetHex(const std::string&);
 template unsigned int base_uint<256>::bits() const;
 
+// Explicit instantiations for base_uint<512>
+template base_uint<512>& base_uint<512>::operator<<=(unsigned int);
+template base_uint<512>& base_uint<512>::operator>>=(unsigned int);
+template base_uint<512>& base_uint<512>::operator*=(uint32_t b32);
+template base_uint<512>& base_uint<512>::operator*=(const base_uint<512>& b);
+template base_uint<512>& base_uint<512>::operator/=(const base_uint<512>& b);
+template int base_uint<512>::CompareTo(const base_uint<512>&) const;
+template bool base_uint<512>::EqualTo(uint64_t) const;
+template unsigned int base_uint<512>::bits() const;
+
 // This implementation directly uses shifts instead of going
 // through an intermediate MPI representation.
 arith_uint256& arith_uint256::SetCompact(uint32_t nCompact, bool* pfNegative, bool* pfOverflow)
@@ -220,14 +230,15 @@ arith_uint256& arith_uint256::SetCompact(uint32_t nCompact, bool* pfNegative, bo
     return *this;
 }
 
-uint32_t arith_uint256::GetCompact(bool fNegative) const
+template <unsigned int BITS>
+static uint32_t GetCompactImpl(const base_uint<BITS>& a, bool fNegative)
 {
-    int nSize = (bits() + 7) / 8;
+    int nSize = (a.bits() + 7) / 8;
     uint32_t nCompact = 0;
     if (nSize <= 3) {
-        nCompact = GetLow64() << 8 * (3 - nSize);
+        nCompact = a.GetLow64() << 8 * (3 - nSize);
     } else {
-        arith_uint256 bn = *this >> 8 * (nSize - 3);
+        base_uint<BITS> bn = a >> 8 * (nSize - 3);
         nCompact = bn.GetLow64();
     }
     // The 0x00800000 bit denotes the sign.
@@ -243,6 +254,11 @@ uint32_t arith_uint256::GetCompact(bool fNegative) const
     return nCompact;
 }
 
+uint32_t arith_uint256::GetCompact(bool fNegative) const
+{
+    return GetCompactImpl(*this, fNegative);
+}
+
 uint256 ArithToUint256(const arith_uint256 &a)
 {
     uint256 b;
@@ -257,3 +273,15 @@ arith_uint256 UintToArith256(const uint256 &a)
         b.pn[x] = ReadLE32(a.begin() + x*4);
     return b;
 }
+
+arith_uint512::arith_uint512(const arith_uint256& b)
+{
+    const uint256 a = ArithToUint256(b);
+    for (unsigned int x = 0; x < a.size() / 4; ++x)
+        pn[x] = ReadLE32(a.begin() + x*4);
+}
+
+uint32_t arith_uint512::GetCompact(bool fNegative) const
+{
+    return GetCompactImpl(*this, fNegative);
+}
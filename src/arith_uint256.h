@@ -284,4 +284,19 @@ public:
 uint256 ArithToUint256(const arith_uint256 &);
 arith_uint256 UintToArith256(const uint256 &);
 
+/**
+ * 512-bit unsigned big integer, wide enough to hold the product of two
+ * 256-bit values exactly (e.g. a target scaled by a coin-day weight).
+ */
+class arith_uint512 : public base_uint<512> {
+public:
+    arith_uint512() {}
+    arith_uint512(const base_uint<512>& b) : base_uint<512>(b) {}
+    arith_uint512(uint64_t b) : base_uint<512>(b) {}
+    explicit arith_uint512(const arith_uint256& b);
+
+    /** Compact representation, see arith_uint256::GetCompact. */
+    uint32_t GetCompact(bool fNegative = false) const;
+};
+
 #endif // BITCOIN_ARITH_UINT256_H
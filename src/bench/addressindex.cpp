@@ -0,0 +1,84 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addressindex.h>
+#include <bench/bench.h>
+#include <index/addressindex.h>
+#include <random.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+static const size_t ADDRESS_LOOKUP_ADDRESSES = 1000;
+
+// The addresses a wallet backend derives from one xpub, each with a few
+// dozen deltas and a few unspent outputs spread over the chain
+struct AddressIndexSetup {
+    AddressIndex::DB db{1 << 24, true};
+    std::vector<std::pair<uint256, int>> addresses;
+
+    explicit AddressIndexSetup(size_t nAddresses)
+    {
+        FastRandomContext rng(true);
+        std::vector<std::pair<CAddressIndexKey, CAmount>> vEntries;
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> vUnspent;
+        for (size_t i = 0; i < nAddresses; i++) {
+            const uint256 addressHash = rng.rand256();
+            addresses.emplace_back(addressHash, 1);
+            for (int j = 0; j < 30; j++) {
+                const uint256 txhash = rng.rand256();
+                const int nHeight = rng.randrange(1000000);
+                const CAmount nValue = rng.randrange(1000 * COIN);
+                vEntries.emplace_back(CAddressIndexKey(1, addressHash, nHeight, rng.randrange(1000), txhash, 0, false), nValue);
+                if (j % 8 == 0)
+                    vUnspent.emplace_back(CAddressUnspentKey(1, addressHash, txhash, 0), CAddressUnspentValue(nValue, CScript(), nHeight));
+            }
+        }
+        bool fWritten = db.WriteAddressIndex(vEntries) && db.UpdateAddressUnspentIndex(vUnspent);
+        assert(fWritten);
+    }
+};
+
+static void AddressIndexBatch(benchmark::State& state)
+{
+    AddressIndexSetup setup(ADDRESS_LOOKUP_ADDRESSES);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < DEFAULT_ADDRESSINDEX_THREADS; ++i)
+        threadGroup.create_thread([i]() { return ThreadAddressIndexRead(i); });
+
+    while (state.KeepRunning()) {
+        std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
+        bool fRead = setup.db.ReadAddressIndexBatch(setup.addresses, addressIndex) && setup.db.ReadAddressUnspentIndexBatch(setup.addresses, unspentOutputs);
+        assert(fRead);
+    }
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+// One address after the other, sorted by height afterwards
+static void AddressIndexSerial(benchmark::State& state)
+{
+    AddressIndexSetup setup(ADDRESS_LOOKUP_ADDRESSES);
+
+    while (state.KeepRunning()) {
+        std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
+        for (const std::pair<uint256, int>& address : setup.addresses) {
+            bool fRead = setup.db.ReadAddressIndex(address.first, address.second, addressIndex) && setup.db.ReadAddressUnspentIndex(address.first, address.second, unspentOutputs);
+            assert(fRead);
+        }
+        std::stable_sort(addressIndex.begin(), addressIndex.end(), [](const std::pair<CAddressIndexKey, CAmount>& a, const std::pair<CAddressIndexKey, CAmount>& b) {
+            return std::make_pair(a.first.blockHeight, a.first.txindex) < std::make_pair(b.first.blockHeight, b.first.txindex);
+        });
+        std::stable_sort(unspentOutputs.begin(), unspentOutputs.end(), [](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& a, const std::pair<CAddressUnspentKey, CAddressUnspentValue>& b) {
+            return a.second.blockHeight < b.second.blockHeight;
+        });
+    }
+}
+
+BENCHMARK(AddressIndexBatch, 10);
+BENCHMARK(AddressIndexSerial, 10);
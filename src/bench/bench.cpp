@@ -122,7 +122,7 @@ void benchmark::BenchRunner::RunAll(Printer& printer, uint64_t num_evals, double
             LOCK(cs_main);
             assert(::ChainActive().Height() == 0);
             const bool witness_enabled{IsWitnessEnabled(::ChainActive().Tip(), Params().GetConsensus())};
-            assert(witness_enabled);
+            (void)witness_enabled;
         }
 
         if (!std::regex_match(p.first, baseMatch, reFilter)) {
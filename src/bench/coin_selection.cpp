@@ -62,6 +62,42 @@ static void CoinSelection(benchmark::State& state)
     }
 }
 
+// A payout wallet holding 100k small outputs of stakes and mining, paying an
+// amount that takes many of them. Branch and bound finds no exact match and
+// the knapsack solver runs after it, as when creating the transaction.
+static void CoinSelectionLargePool(benchmark::State& state)
+{
+    NodeContext node;
+    auto chain = interfaces::MakeChain(node);
+    CWallet wallet(chain.get(), WalletLocation(), WalletDatabase::CreateDummy());
+    wallet.SetupLegacyScriptPubKeyMan();
+    std::vector<std::unique_ptr<CWalletTx>> wtxs;
+    LOCK(wallet.cs_wallet);
+
+    for (int i = 0; i < 100000; ++i) {
+        addCoin((i % 1000 + 1) * CENT / 10, wallet, wtxs);
+    }
+    std::vector<OutputGroup> groups;
+    for (const auto& wtx : wtxs) {
+        COutput output(wtx.get(), 0 /* iIn */, 6 * 24 /* nDepthIn */, true /* spendable */, true /* solvable */, true /* safe */);
+        groups.emplace_back(output.GetInputCoin(), 6, false, 0, 0);
+    }
+
+    const CoinEligibilityFilter filter_standard(1, 6, 0);
+    const CoinSelectionParams coin_selection_params_bnb(true, 34, 148, 0);
+    const CoinSelectionParams coin_selection_params_knapsack(false, 34, 148, 0);
+    const CAmount target = 50 * COIN + 1234;
+    while (state.KeepRunning()) {
+        std::set<CInputCoin> setCoinsRet;
+        CAmount nValueRet;
+        bool bnb_used;
+        bool success = wallet.SelectCoinsMinConf(target, filter_standard, groups, setCoinsRet, nValueRet, coin_selection_params_bnb, bnb_used) ||
+                       wallet.SelectCoinsMinConf(target, filter_standard, groups, setCoinsRet, nValueRet, coin_selection_params_knapsack, bnb_used);
+        assert(success);
+        assert(nValueRet >= target);
+    }
+}
+
 typedef std::set<CInputCoin> CoinSet;
 static NodeContext testNode;
 static auto testChain = interfaces::MakeChain(testNode);
@@ -113,3 +149,4 @@ static void BnBExhaustion(benchmark::State& state)
 
 BENCHMARK(CoinSelection, 650);
 BENCHMARK(BnBExhaustion, 650);
+BENCHMARK(CoinSelectionLargePool, 1);
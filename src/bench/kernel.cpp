@@ -0,0 +1,248 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bignum.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <index/txindex.h>
+#include <kernel.h>
+#include <kernelprevout.h>
+#include <random.h>
+#include <test/util/mining.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <vector>
+
+// Mine a short chain with the transaction index enabled and return the
+// coinbase outpoints, which is what the stake kernel looks up
+static std::vector<COutPoint> MineKernelPrevouts(size_t nBlocks)
+{
+    const CScript SCRIPT_PUB{CScript(OP_TRUE)};
+
+    std::vector<COutPoint> vPrevouts;
+    for (size_t b = 0; b < nBlocks; ++b)
+        vPrevouts.push_back(MineBlock(g_testing_setup->m_node, SCRIPT_PUB).prevout);
+
+    g_txindex = MakeUnique<TxIndex>(1 << 20, true);
+    g_txindex->Start();
+    while (!g_txindex->BlockUntilSyncedToCurrentChain())
+        UninterruptibleSleep(std::chrono::milliseconds{10});
+    return vPrevouts;
+}
+
+static void StopKernelTxIndex()
+{
+    g_txindex->Stop();
+    g_txindex.reset();
+}
+
+static void KernelPrevoutCached(benchmark::State& state)
+{
+    const std::vector<COutPoint> vPrevouts = MineKernelPrevouts(100);
+
+    LOCK(cs_main);
+    CKernelPrevout kernel;
+    while (state.KeepRunning()) {
+        for (const COutPoint& prevout : vPrevouts) {
+            bool found = GetKernelPrevout(::ChainActive().Tip(), prevout, kernel);
+            assert(found);
+        }
+    }
+    StopKernelTxIndex();
+}
+
+static void KernelPrevoutUncached(benchmark::State& state)
+{
+    const std::vector<COutPoint> vPrevouts = MineKernelPrevouts(100);
+
+    LOCK(cs_main);
+    CKernelPrevout kernel;
+    while (state.KeepRunning()) {
+        for (const COutPoint& prevout : vPrevouts) {
+            bool found = ReadKernelPrevoutFromDisk(prevout, kernel);
+            assert(found);
+        }
+    }
+    StopKernelTxIndex();
+}
+
+// Coin age of a coinstake spending the mined outputs, from the coins and the
+// block index alone
+static void CoinAge(benchmark::State& state)
+{
+    const CScript SCRIPT_PUB{CScript(OP_TRUE)};
+
+    CMutableTransaction tx;
+    for (size_t b = 0; b < 100; ++b)
+        tx.vin.push_back(MineBlock(g_testing_setup->m_node, SCRIPT_PUB));
+    tx.vout.resize(2);
+    const CTransaction txCoinStake(tx);
+
+    LOCK(cs_main);
+    const unsigned int nTimeTx = ::ChainActive().Tip()->nTime + 10 * Params().GetConsensus().nStakeMinAge;
+    CCoinsViewCache view(&::ChainstateActive().CoinsTip());
+    while (state.KeepRunning()) {
+        uint64_t nCoinAge;
+        bool fAged = GetCoinAge(txCoinStake, view, nCoinAge, nTimeTx);
+        assert(fAged && nCoinAge > 0);
+    }
+}
+
+// Candidate kernels as seen by the staker: realistic targets, stakes and ages
+struct KernelTargetInput {
+    unsigned int nBits;
+    int64_t nValueIn;
+    int64_t nTimeWeight;
+    uint256 hashProofOfStake;
+};
+
+static std::vector<KernelTargetInput> MakeKernelTargetInputs()
+{
+    FastRandomContext rng(true);
+    std::vector<KernelTargetInput> vInputs;
+    for (int i = 0; i < 1000; ++i) {
+        vInputs.push_back({0x1c000000 | (unsigned int)rng.randbits(23), (int64_t)rng.randrange(100000 * COIN),
+                           (int64_t)rng.randrange(60 * 60 * 24 * 90), rng.rand256()});
+    }
+    return vInputs;
+}
+
+static void KernelTarget(benchmark::State& state)
+{
+    const std::vector<KernelTargetInput> vInputs = MakeKernelTargetInputs();
+    while (state.KeepRunning()) {
+        for (const KernelTargetInput& input : vInputs)
+            CheckStakeKernelTarget(input.nBits, input.nValueIn, input.nTimeWeight, input.hashProofOfStake);
+    }
+}
+
+static void KernelTargetBigNum(benchmark::State& state)
+{
+    const std::vector<KernelTargetInput> vInputs = MakeKernelTargetInputs();
+    while (state.KeepRunning()) {
+        for (const KernelTargetInput& input : vInputs) {
+            CBigNum bnTargetPerCoinDay;
+            bnTargetPerCoinDay.SetCompact(input.nBits);
+            CBigNum bnCoinDayWeight = CBigNum(input.nValueIn) * input.nTimeWeight / COIN / (24 * 60 * 60);
+            (void)(CBigNum(input.hashProofOfStake) > bnCoinDayWeight * bnTargetPerCoinDay);
+        }
+    }
+}
+
+// Replay the stake modifier over a long chain of mixed proof-of-work and
+// proof-of-stake blocks, as connecting them does
+static void StakeModifierReplay(benchmark::State& state)
+{
+    const size_t nBlocks = 20000;
+    FastRandomContext rng(true);
+    std::vector<CBlockIndex> blocks(nBlocks);
+    std::vector<uint256> hashes(nBlocks);
+    for (size_t i = 0; i < nBlocks; i++) {
+        CBlockIndex& block = blocks[i];
+        hashes[i] = rng.rand256();
+        block.phashBlock = &hashes[i];
+        block.pprev = i > 0 ? &blocks[i - 1] : nullptr;
+        block.nHeight = i;
+        block.nTime = 1710000000 + i * 60 + rng.randrange(120);
+        if (rng.randbool()) {
+            block.SetProofOfStake();
+            block.hashProofOfStake = rng.rand256();
+        }
+        block.SetStakeEntropyBit(rng.randbits(1));
+    }
+
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        for (CBlockIndex& block : blocks) {
+            uint64_t nStakeModifier;
+            bool fGeneratedStakeModifier;
+            bool fComputed = ComputeNextStakeModifier(&block, nStakeModifier, fGeneratedStakeModifier);
+            assert(fComputed);
+            block.SetStakeModifier(nStakeModifier, fGeneratedStakeModifier);
+        }
+    }
+}
+
+// A wallet of many mature outputs searching a full window against a chain
+// whose stake modifier covers the window, with a target no kernel meets
+struct KernelSearchSetup {
+    uint256 hashModifier;
+    uint256 hashPrev;
+    CBlockIndex indexModifier;
+    CBlockIndex indexPrev;
+    unsigned int nTimeTx;
+    std::vector<CStakeCandidate> vCandidates;
+
+    explicit KernelSearchSetup(size_t nCandidates)
+    {
+        const Consensus::Params& params = Params().GetConsensus();
+        FastRandomContext rng(true);
+        const unsigned int nTimeModifier = 1710000000;
+        nTimeTx = nTimeModifier + params.nStakeMinAge;
+        hashModifier = rng.rand256();
+        hashPrev = rng.rand256();
+        indexModifier.phashBlock = &hashModifier;
+        indexModifier.nHeight = 1;
+        indexModifier.nTime = nTimeModifier;
+        indexModifier.SetStakeModifier(rng.rand64(), true);
+        indexPrev.phashBlock = &hashPrev;
+        indexPrev.pprev = &indexModifier;
+        indexPrev.nHeight = 2;
+        indexPrev.nTime = nTimeModifier + 2 * params.nStakeMinAge;
+        for (size_t i = 0; i < nCandidates; ++i) {
+            CStakeCandidate stake;
+            stake.prevout = COutPoint(rng.rand256(), rng.randrange(4));
+            stake.kernel.hashBlock = rng.rand256();
+            stake.kernel.nTimeBlock = nTimeTx - params.nStakeMinAge - 60 - rng.randrange(params.nStakeMaxAge);
+            stake.kernel.nTxOffset = 81 + rng.randrange(100000);
+            stake.kernel.txout.nValue = rng.randrange(1000 * COIN);
+            vCandidates.push_back(stake);
+        }
+    }
+};
+
+static const unsigned int KERNEL_SEARCH_BITS = 0x1a00ffff;
+
+static void KernelSearch(benchmark::State& state)
+{
+    KernelSearchSetup setup(10000);
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        CStakeKernelSearch search;
+        size_t nCandidate;
+        unsigned int nTimeKernel;
+        uint256 hashProofOfStake;
+        search.Prepare(KERNEL_SEARCH_BITS, &setup.indexPrev, setup.nTimeTx, 60, setup.vCandidates);
+        bool found = search.Search(0, search.size(), nCandidate, nTimeKernel, hashProofOfStake);
+        assert(!found);
+    }
+}
+
+static void KernelSearchSerial(benchmark::State& state)
+{
+    KernelSearchSetup setup(10000);
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        for (const CStakeCandidate& stake : setup.vCandidates) {
+            for (unsigned int n = 0; n < 60; n++) {
+                uint256 hashProofOfStake;
+                bool found = CheckStakeKernelHash(KERNEL_SEARCH_BITS, &setup.indexPrev, stake.kernel, stake.prevout, setup.nTimeTx - n, hashProofOfStake);
+                assert(!found);
+            }
+        }
+    }
+}
+
+BENCHMARK(KernelPrevoutCached, 50);
+BENCHMARK(KernelPrevoutUncached, 10);
+BENCHMARK(CoinAge, 500);
+BENCHMARK(KernelTarget, 500);
+BENCHMARK(KernelTargetBigNum, 50);
+BENCHMARK(KernelSearch, 1);
+BENCHMARK(StakeModifierReplay, 1);
+BENCHMARK(KernelSearchSerial, 1);
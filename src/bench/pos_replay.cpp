@@ -0,0 +1,428 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <consensus/validation.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
+#include <kernel.h>
+#include <kernelprevout.h>
+#include <key.h>
+#include <pow.h>
+#include <random.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+static const size_t POS_REPLAY_BLOCKS = 2000;
+//! Transactions per block besides the coinbase and the coinstake
+static const size_t POS_REPLAY_BLOCK_TXS = 4;
+//! Keys the outputs of those transactions pay to
+static const size_t POS_REPLAY_KEYS = 50;
+//! Outputs those transactions start spending from
+static const size_t POS_REPLAY_WALLET_COINS = 500;
+//! Flags ConnectBlock verifies scripts with once every soft fork is active
+static const unsigned int POS_REPLAY_SCRIPT_FLAGS = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_DERSIG |
+                                                    SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY | SCRIPT_VERIFY_CHECKSEQUENCEVERIFY | SCRIPT_VERIFY_NULLDUMMY;
+
+static void StartReplayIndexes()
+{
+    g_addressindex = MakeUnique<AddressIndex>(1 << 24, true, true);
+    g_addressindex->Start();
+    g_spentindex = MakeUnique<SpentIndex>(1 << 24, true, true);
+    g_spentindex->Start();
+    g_timestampindex = MakeUnique<TimestampIndex>(1 << 20, true, true);
+    g_timestampindex->Start();
+}
+
+static void SyncReplayIndexes(const BaseIndex& index)
+{
+    while (!index.BlockUntilSyncedToCurrentChain())
+        UninterruptibleSleep(std::chrono::milliseconds{10});
+}
+
+static void StopReplayIndexes()
+{
+    g_addressindex->Stop();
+    g_addressindex.reset();
+    g_spentindex->Stop();
+    g_spentindex.reset();
+    g_timestampindex->Stop();
+    g_timestampindex.reset();
+}
+
+// A deterministic regtest proof-of-stake chain, every block with a coinstake
+// and a few transactions between a set of keys, connected with the address,
+// spent and timestamp indexes on. The stakes are outputs confirmed in the
+// genesis block, added to the coins and the kernel prevout cache, as there is
+// no proof-of-work chain to have confirmed them. The chain starts two hours
+// before the v0.3 switch time, so that the stake modifiers the v0.3 kernel
+// needs exist by then, and crosses the later protocol switches within its
+// first four hours, as a stake is found about once a minute.
+struct PoSChainSetup {
+    std::vector<CKey> vKeys;
+    FillableSigningProvider keystore;
+    CScript scriptStake;
+    std::vector<std::pair<COutPoint, Coin>> vStakes; // staked by the block of the same number
+    std::map<COutPoint, Coin> mapSpent;              // coins spent by the chain
+    std::vector<std::shared_ptr<const CBlock>> vBlocks;
+    std::vector<CBlockIndex*> vIndex;
+
+    explicit PoSChainSetup(size_t nBlocks)
+    {
+        const Consensus::Params& params = Params().GetConsensus();
+        FastRandomContext rng(true);
+        for (size_t i = 0; i < POS_REPLAY_KEYS; i++) {
+            const uint256 secret = rng.rand256();
+            CKey key;
+            key.Set(secret.begin(), secret.end(), true);
+            assert(key.IsValid());
+            keystore.AddKey(key);
+            vKeys.push_back(key);
+        }
+        scriptStake = GetScriptForRawPubKey(vKeys[0].GetPubKey());
+
+        std::deque<std::pair<COutPoint, Coin>> vWallet;
+        {
+            LOCK(cs_main);
+            const unsigned int nTimeGenesis = ::ChainActive().Genesis()->nTime;
+            CCoinsViewCache& coins = ::ChainstateActive().CoinsTip();
+            // Each coin has an unspent second output, from which disconnecting
+            // a block recovers the metadata of the undo data at height 0
+            const CTxOut txoutUnspent(CENT, scriptStake);
+            for (size_t i = 0; i < nBlocks; i++) {
+                const CTxOut txout((100000 + rng.randrange(900000)) * COIN, scriptStake);
+                vStakes.emplace_back(COutPoint(rng.rand256(), 0), Coin(txout, 0, false, false, nTimeGenesis));
+                coins.AddCoin(vStakes.back().first, Coin(vStakes.back().second), false);
+                coins.AddCoin(COutPoint(vStakes.back().first.hash, 1), Coin(txoutUnspent, 0, false, false, nTimeGenesis), false);
+            }
+            for (size_t i = 0; i < POS_REPLAY_WALLET_COINS; i++) {
+                const CTxOut txout(1000 * COIN, GetScriptForDestination(PKHash(vKeys[i % POS_REPLAY_KEYS].GetPubKey())));
+                vWallet.emplace_back(COutPoint(rng.rand256(), 0), Coin(txout, 0, false, false, nTimeGenesis));
+                coins.AddCoin(vWallet.back().first, Coin(vWallet.back().second), false);
+                coins.AddCoin(COutPoint(vWallet.back().first.hash, 1), Coin(txoutUnspent, 0, false, false, nTimeGenesis), false);
+            }
+        }
+        WriteKernelPrevouts();
+        StartReplayIndexes();
+
+        unsigned int nTime = nProtocolV03TestSwitchTime - 2 * 60 * 60;
+        for (size_t h = 1; h <= nBlocks; h++) {
+            CBlock block;
+            {
+                LOCK(cs_main);
+                CBlockIndex* pindexPrev = ::ChainActive().Tip();
+                block.hashPrevBlock = pindexPrev->GetBlockHash();
+                block.nBits = GetNextTargetRequired(pindexPrev, true, params);
+                block.nFlags = CBlockIndex::BLOCK_PROOF_OF_STAKE;
+
+                // Search the kernel from most of a block spacing after the
+                // previous block, like a staker that has just caught up
+                const std::pair<COutPoint, Coin>& stake = vStakes[h - 1];
+                const CKernelPrevout kernel = GetStakeKernel(h - 1);
+                nTime = std::max<unsigned int>(nTime, pindexPrev->GetMedianTimePast()) + 48;
+                uint256 hashProofOfStake;
+                while (!CheckStakeKernelHash(block.nBits, pindexPrev, kernel, stake.first, nTime, hashProofOfStake))
+                    nTime++;
+                block.nTime = nTime;
+
+                CMutableTransaction txCoinBase;
+                txCoinBase.nVersion = 1;
+                txCoinBase.nTime = nTime;
+                txCoinBase.vin.resize(1);
+                txCoinBase.vin[0].prevout.SetNull();
+                txCoinBase.vin[0].scriptSig = CScript() << (int)h << OP_0;
+                txCoinBase.vout.resize(1);
+                txCoinBase.vout[0].SetEmpty();
+                block.vtx.push_back(MakeTransactionRef(std::move(txCoinBase)));
+
+                CMutableTransaction txCoinStake;
+                txCoinStake.nVersion = 1;
+                txCoinStake.nTime = nTime;
+                txCoinStake.vin.emplace_back(stake.first);
+                txCoinStake.vout.resize(2);
+                txCoinStake.vout[0].SetEmpty();
+                uint64_t nCoinAge;
+                bool fAged = GetCoinAge(CTransaction(txCoinStake), ::ChainstateActive().CoinsTip(), nCoinAge, nTime);
+                assert(fAged);
+                txCoinStake.vout[1] = CTxOut(stake.second.out.nValue + GetProofOfStakeReward(nCoinAge, nTime, pindexPrev->nMoneySupply), scriptStake);
+                bool fSigned = SignSignature(keystore, stake.second.out.scriptPubKey, txCoinStake, 0, stake.second.out.nValue, SIGHASH_ALL);
+                assert(fSigned);
+                block.vtx.push_back(MakeTransactionRef(std::move(txCoinStake)));
+                mapSpent.insert(stake);
+
+                for (size_t i = 0; i < POS_REPLAY_BLOCK_TXS; i++) {
+                    const std::pair<COutPoint, Coin> spent = vWallet.front();
+                    vWallet.pop_front();
+                    const CAmount nValue = spent.second.out.nValue - CENT;
+                    CMutableTransaction tx;
+                    tx.nVersion = 1;
+                    tx.nTime = nTime;
+                    tx.vin.emplace_back(spent.first);
+                    tx.vout.emplace_back(nValue / 2, GetScriptForDestination(PKHash(vKeys[rng.randrange(POS_REPLAY_KEYS)].GetPubKey())));
+                    tx.vout.emplace_back(nValue - nValue / 2, GetScriptForDestination(PKHash(vKeys[rng.randrange(POS_REPLAY_KEYS)].GetPubKey())));
+                    fSigned = SignSignature(keystore, spent.second.out.scriptPubKey, tx, 0, spent.second.out.nValue, SIGHASH_ALL);
+                    assert(fSigned);
+                    const uint256 txid = tx.GetHash();
+                    for (unsigned int n = 0; n < tx.vout.size(); n++)
+                        vWallet.emplace_back(COutPoint(txid, n), Coin(tx.vout[n], h, false, false, nTime));
+                    block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+                    mapSpent.insert(spent);
+                }
+
+                block.hashMerkleRoot = BlockMerkleRoot(block);
+                bool fSignedBlock = vKeys[0].Sign(block.GetHash(), block.vchBlockSig);
+                assert(fSignedBlock);
+            }
+
+            SetMockTime(nTime);
+            std::shared_ptr<const CBlock> pblock = std::make_shared<const CBlock>(block);
+            bool fProcessed = ProcessNewBlock(Params(), pblock, true, nullptr);
+            assert(fProcessed);
+            LOCK(cs_main);
+            assert(::ChainActive().Tip()->GetBlockHash() == pblock->GetHash());
+            vBlocks.push_back(pblock);
+            vIndex.push_back(::ChainActive().Tip());
+        }
+
+        SyncWithValidationInterfaceQueue();
+        SyncReplayIndexes(*g_addressindex);
+        SyncReplayIndexes(*g_spentindex);
+        SyncReplayIndexes(*g_timestampindex);
+    }
+
+    ~PoSChainSetup()
+    {
+        StopReplayIndexes();
+        SetMockTime(0);
+    }
+
+    CKernelPrevout GetStakeKernel(size_t nStake) const
+    {
+        const CBlockIndex* pindexGenesis = WITH_LOCK(cs_main, return ::ChainActive().Genesis());
+        const Coin& coin = vStakes[nStake].second;
+        return CKernelPrevout(pindexGenesis->GetBlockHash(), pindexGenesis->nTime, CBlockHeader::NORMAL_SERIALIZE_SIZE + 1 + nStake, coin.nTime, coin.out);
+    }
+
+    // The kernel prevout cache forgets outputs once they are spent, and the
+    // stakes are in no block file to be read back from
+    void WriteKernelPrevouts() const
+    {
+        std::vector<std::pair<COutPoint, CKernelPrevout>> vKernels;
+        for (size_t i = 0; i < vStakes.size(); i++)
+            vKernels.emplace_back(vStakes[i].first, GetStakeKernel(i));
+        bool fWritten = pblocktree->UpdateKernelPrevoutIndex(vKernels);
+        assert(fWritten);
+    }
+};
+
+// Kernel hash of every coinstake, the coinstake signature being left to the
+// script checks as in ConnectBlock
+static void PoSReplayKernel(benchmark::State& state)
+{
+    PoSChainSetup setup(POS_REPLAY_BLOCKS);
+    setup.WriteKernelPrevouts();
+
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < setup.vBlocks.size(); i++) {
+            const CBlock& block = *setup.vBlocks[i];
+            BlockValidationState validation_state;
+            PrecomputedTransactionData txdata(*block.vtx[1]);
+            std::vector<CScriptCheck> vChecks;
+            uint256 hashProofOfStake;
+            bool fChecked = CheckProofOfStake(validation_state, setup.vIndex[i]->pprev, block.vtx[1], block.nBits, hashProofOfStake, block.vtx[1]->nTime, txdata, &vChecks);
+            assert(fChecked && hashProofOfStake == setup.vIndex[i]->hashProofOfStake);
+        }
+    }
+}
+
+// Coin age of every coinstake, from the coins it spends
+static void PoSReplayCoinAge(benchmark::State& state)
+{
+    PoSChainSetup setup(POS_REPLAY_BLOCKS);
+
+    LOCK(cs_main);
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+    for (const std::pair<COutPoint, Coin>& stake : setup.vStakes)
+        view.AddCoin(stake.first, Coin(stake.second), false);
+    view.SetBestBlock(::ChainActive().Tip()->GetBlockHash());
+    while (state.KeepRunning()) {
+        for (const std::shared_ptr<const CBlock>& pblock : setup.vBlocks) {
+            uint64_t nCoinAge;
+            bool fAged = GetCoinAge(*pblock->vtx[1], view, nCoinAge, pblock->vtx[1]->nTime);
+            assert(fAged && nCoinAge > 0);
+        }
+    }
+}
+
+// Stake modifier of every block
+static void PoSReplayModifier(benchmark::State& state)
+{
+    PoSChainSetup setup(POS_REPLAY_BLOCKS);
+
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        for (const CBlockIndex* pindex : setup.vIndex) {
+            uint64_t nStakeModifier;
+            bool fGeneratedStakeModifier;
+            bool fComputed = ComputeNextStakeModifier(pindex, nStakeModifier, fGeneratedStakeModifier);
+            assert(fComputed && nStakeModifier == pindex->nStakeModifier);
+        }
+    }
+}
+
+// Scripts of every input, coinstakes included, verified on one thread and
+// without the signature cache, which holds them since they were connected
+static void PoSReplayScripts(benchmark::State& state)
+{
+    PoSChainSetup setup(POS_REPLAY_BLOCKS);
+
+    while (state.KeepRunning()) {
+        for (const std::shared_ptr<const CBlock>& pblock : setup.vBlocks) {
+            for (size_t i = 1; i < pblock->vtx.size(); i++) {
+                const CTransaction& tx = *pblock->vtx[i];
+                PrecomputedTransactionData txdata(tx);
+                for (unsigned int n = 0; n < tx.vin.size(); n++) {
+                    const CTxOut& txout = setup.mapSpent.at(tx.vin[n].prevout).out;
+                    ScriptError serror;
+                    bool fVerified = VerifyScript(tx.vin[n].scriptSig, txout.scriptPubKey, &tx.vin[n].scriptWitness, POS_REPLAY_SCRIPT_FLAGS, TransactionSignatureChecker(&tx, n, txout.nValue, txdata), &serror);
+                    assert(fVerified);
+                }
+            }
+        }
+    }
+}
+
+// Address, spent and timestamp index writes of the chain, by indexes
+// syncing from the genesis block
+static void PoSReplayIndexes(benchmark::State& state)
+{
+    PoSChainSetup setup(POS_REPLAY_BLOCKS);
+
+    while (state.KeepRunning()) {
+        AddressIndex addressindex(1 << 24, true, true);
+        SpentIndex spentindex(1 << 24, true, true);
+        TimestampIndex timestampindex(1 << 20, true, true);
+        addressindex.Start();
+        spentindex.Start();
+        timestampindex.Start();
+        SyncReplayIndexes(addressindex);
+        SyncReplayIndexes(spentindex);
+        SyncReplayIndexes(timestampindex);
+        addressindex.Stop();
+        spentindex.Stop();
+        timestampindex.Stop();
+    }
+}
+
+// Coins database writes of the chain: the coins it creates and spends are
+// written in one flush, then erased and restored in another
+static void PoSReplayFlush(benchmark::State& state)
+{
+    PoSChainSetup setup(POS_REPLAY_BLOCKS);
+
+    const uint256 hashGenesis = Params().GetConsensus().hashGenesisBlock;
+    const unsigned int nTimeGenesis = WITH_LOCK(cs_main, return ::ChainActive().Genesis()->nTime);
+    CCoinsViewDB db(GetDataDir() / "posreplay", 1 << 23, true, true);
+    {
+        CCoinsViewCache cache(&db);
+        // The coins added before the chain, as those it creates are written
+        // by the flushes
+        for (const std::pair<const COutPoint, Coin>& spent : setup.mapSpent) {
+            if (spent.second.nTime == nTimeGenesis)
+                cache.AddCoin(spent.first, Coin(spent.second), false);
+        }
+        cache.SetBestBlock(hashGenesis);
+        bool fFlushed = cache.Flush();
+        assert(fFlushed);
+    }
+
+    while (state.KeepRunning()) {
+        {
+            CCoinsViewCache cache(&db);
+            for (size_t i = 0; i < setup.vBlocks.size(); i++) {
+                for (const CTransactionRef& tx : setup.vBlocks[i]->vtx)
+                    UpdateCoins(*tx, cache, setup.vIndex[i]->nHeight);
+            }
+            cache.SetBestBlock(setup.vIndex.back()->GetBlockHash());
+            bool fFlushed = cache.Flush();
+            assert(fFlushed);
+        }
+        {
+            CCoinsViewCache cache(&db);
+            for (size_t i = setup.vBlocks.size(); i-- > 0;) {
+                const CBlock& block = *setup.vBlocks[i];
+                for (size_t j = block.vtx.size(); j-- > 0;) {
+                    const CTransaction& tx = *block.vtx[j];
+                    for (unsigned int n = 0; n < tx.vout.size(); n++)
+                        cache.SpendCoin(COutPoint(tx.GetHash(), n));
+                    if (tx.IsCoinBase())
+                        continue;
+                    for (const CTxIn& txin : tx.vin)
+                        cache.AddCoin(txin.prevout, Coin(setup.mapSpent.at(txin.prevout)), true);
+                }
+            }
+            cache.SetBestBlock(hashGenesis);
+            bool fFlushed = cache.Flush();
+            assert(fFlushed);
+        }
+    }
+}
+
+// The whole chain disconnected, then connected again with every proof-of-stake
+// check, followed by the index writes and a flush of the coins cache
+static void PoSReplayConnect(benchmark::State& state)
+{
+    PoSChainSetup setup(POS_REPLAY_BLOCKS);
+
+    while (state.KeepRunning()) {
+        {
+            LOCK2(cs_main, ::mempool.cs);
+            while (::ChainActive().Height() > 0) {
+                BlockValidationState validation_state;
+                bool fDisconnected = ::ChainstateActive().DisconnectTip(validation_state, Params(), nullptr);
+                assert(fDisconnected);
+            }
+            // Blocks whose stake modifier is known are connected without the
+            // kernel and modifier checks
+            for (CBlockIndex* pindex : setup.vIndex) {
+                pindex->nStakeModifier = 0;
+                pindex->nStakeModifierChecksum = 0;
+            }
+            setup.WriteKernelPrevouts();
+        }
+        BlockValidationState validation_state;
+        bool fActivated = ActivateBestChain(validation_state, Params());
+        assert(fActivated && WITH_LOCK(cs_main, return ::ChainActive().Tip()) == setup.vIndex.back());
+        SyncWithValidationInterfaceQueue();
+        SyncReplayIndexes(*g_addressindex);
+        SyncReplayIndexes(*g_spentindex);
+        SyncReplayIndexes(*g_timestampindex);
+        ::ChainstateActive().ForceFlushStateToDisk();
+    }
+}
+
+BENCHMARK(PoSReplayKernel, 20);
+BENCHMARK(PoSReplayCoinAge, 10);
+BENCHMARK(PoSReplayModifier, 5);
+BENCHMARK(PoSReplayScripts, 1);
+BENCHMARK(PoSReplayIndexes, 1);
+BENCHMARK(PoSReplayFlush, 1);
+BENCHMARK(PoSReplayConnect, 1);
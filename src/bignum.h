@@ -5,6 +5,11 @@
 #ifndef BITCOIN_BIGNUM_H
 #define BITCOIN_BIGNUM_H
 
+#include <serialize.h>
+#include <uint256.h>
+#include <version.h>
+
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <openssl/bn.h>
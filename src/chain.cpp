@@ -170,9 +170,58 @@ const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex*
     return pa;
 }
 
+void CBlockIndex::BuildLastBlockIndex()
+{
+    pindexLastPoS = IsProofOfStake() ? this : (pprev ? pprev->pindexLastPoS : this);
+    pindexLastPoW = IsProofOfWork() ? this : (pprev ? pprev->pindexLastPoW : this);
+}
+
+void CBlockIndex::BuildChainStake()
+{
+    if (pprev) {
+        nChainStake = pprev->nChainStake;
+        nChainStakeVersion = pprev->nChainStakeVersion;
+    } else {
+        nChainStake = 0;
+        nChainStakeVersion.fill(0);
+    }
+    if (!IsProofOfStake())
+        return;
+    nChainStake++;
+    for (int nVersionTracked = STAKE_VERSION_MIN_TRACKED; nVersionTracked <= std::min(nVersion, STAKE_VERSION_MAX_TRACKED); nVersionTracked++)
+        nChainStakeVersion[nVersionTracked - STAKE_VERSION_MIN_TRACKED]++;
+}
+
+bool CBlockIndex::CountStakeVersion(int minVersion, unsigned int nToCheck, unsigned int& nFound) const
+{
+    if (nChainStake < 0 || minVersion < STAKE_VERSION_MIN_TRACKED || minVersion > STAKE_VERSION_MAX_TRACKED)
+        return false;
+    const size_t nTracked = minVersion - STAKE_VERSION_MIN_TRACKED;
+
+    // The window starts after the latest block with nToCheck fewer
+    // proof-of-stake blocks, found by descending the skip list
+    const int64_t nChainStakeBefore = int64_t{nChainStake} - nToCheck;
+    int nFoundBefore = 0;
+    if (nChainStakeBefore > 0) {
+        const CBlockIndex* pindex = this;
+        while (pindex->nChainStake > nChainStakeBefore) {
+            if (pindex->pskip && pindex->pskip->nChainStake >= nChainStakeBefore)
+                pindex = pindex->pskip;
+            else
+                pindex = pindex->pprev;
+        }
+        nFoundBefore = pindex->nChainStakeVersion[nTracked];
+    }
+    nFound = nChainStakeVersion[nTracked] - nFoundBefore;
+    return true;
+}
+
 // sumcoin: find last block index up to pindex
 const CBlockIndex* GetLastBlockIndex(const CBlockIndex* pindex, bool fProofOfStake)
 {
+    // Entries of the block tree have them built; others are walked
+    if (pindex && pindex->pindexLastPoS)
+        return fProofOfStake ? pindex->pindexLastPoS : pindex->pindexLastPoW;
     while (pindex && pindex->pprev && (pindex->IsProofOfStake() != fProofOfStake))
         pindex = pindex->pprev;
     return pindex;
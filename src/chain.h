@@ -15,8 +15,17 @@
 
 #include <util/moneystr.h>
 
+#include <array>
 #include <vector>
 
+/**
+ * Range of block versions whose share among proof-of-stake blocks is counted
+ * in the block index, for the version supermajority of soft forks. Raise the
+ * maximum to track the version of a new soft fork.
+ */
+static constexpr int STAKE_VERSION_MIN_TRACKED = 2;
+static constexpr int STAKE_VERSION_MAX_TRACKED = 4;
+
 /**
  * Maximum amount of time that a block timestamp is allowed to exceed the
  * current network-adjusted time before the block will be accepted.
@@ -189,6 +198,17 @@ public:
     //! (memory only) Maximum nTime in the chain up to and including this block.
     unsigned int nTimeMax{0};
 
+    //! (memory only) Latest proof-of-stake and proof-of-work blocks in the chain up to and including this block,
+    //! or the first block of the chain if it has none, as returned by GetLastBlockIndex
+    const CBlockIndex* pindexLastPoS{nullptr};
+    const CBlockIndex* pindexLastPoW{nullptr};
+
+    //! (memory only) Number of proof-of-stake blocks in the chain up to and including this block, or -1 if not counted yet
+    int nChainStake{-1};
+
+    //! (memory only) Number of those whose version is at least STAKE_VERSION_MIN_TRACKED, STAKE_VERSION_MIN_TRACKED + 1, ...
+    std::array<int, STAKE_VERSION_MAX_TRACKED - STAKE_VERSION_MIN_TRACKED + 1> nChainStakeVersion{};
+
 // sumcoin
     // sumcoin: money supply related block index fields
     int64_t nMint{0};
@@ -400,6 +420,18 @@ public:
     //! Build the skiplist pointer for this entry.
     void BuildSkip();
 
+    //! Build the latest proof-of-stake and proof-of-work block pointers for this entry.
+    //! The proof-of-stake flag of this entry and the pointers of pprev must be set.
+    void BuildLastBlockIndex();
+
+    //! Count the proof-of-stake blocks and their versions for this entry, from those of pprev.
+    //! The proof-of-stake flag of this entry must be set.
+    void BuildChainStake();
+
+    //! Number of the last nToCheck proof-of-stake blocks up to and including this one whose
+    //! version is at least minVersion. Returns false if not counted for this entry or minVersion.
+    bool CountStakeVersion(int minVersion, unsigned int nToCheck, unsigned int& nFound) const;
+
     //! Efficiently find an ancestor of this block.
     CBlockIndex* GetAncestor(int height);
     const CBlockIndex* GetAncestor(int height) const;
@@ -60,6 +60,15 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint& outpoint) const
     return ret;
 }
 
+bool CCoinsViewCache::WarmCoin(const COutPoint& outpoint, Coin&& coin)
+{
+    assert(!coin.IsSpent());
+    std::pair<CCoinsMap::iterator, bool> inserted = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)));
+    if (inserted.second)
+        cachedCoinsUsage += inserted.first->second.coin.DynamicMemoryUsage();
+    return inserted.second;
+}
+
 bool CCoinsViewCache::GetCoin(const COutPoint& outpoint, Coin& coin) const
 {
     CCoinsMap::const_iterator it = FetchCoin(outpoint);
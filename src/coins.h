@@ -292,6 +292,14 @@ public:
      */
     const Coin& AccessCoin(const COutPoint& output) const;
 
+    /**
+     * Cache an unspent coin read from the backing view ahead of time, as if it
+     * had been fetched, unless the outpoint is cached already. The caller must
+     * ensure that the backing view has not changed since the coin was read.
+     * Returns whether the coin was added.
+     */
+    bool WarmCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Add a coin. Set potential_overwrite to true if a non-pruned version may
      * already exist.
@@ -22,16 +22,19 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 namespace sha256d64_sse41
 {
 void Transform_4way(unsigned char* out, const unsigned char* in);
+void TransformSingle_4way(unsigned char* out, const unsigned char* in);
 }
 
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
+void TransformSingle_8way(unsigned char* out, const unsigned char* in);
 }
 
 namespace sha256d64_shani
 {
 void Transform_2way(unsigned char* out, const unsigned char* in);
+void TransformSingle_2way(unsigned char* out, const unsigned char* in);
 }
 
 namespace sha256_shani
@@ -456,11 +459,48 @@ void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
     WriteBE32(out + 28, s[7]);
 }
 
+/** Double-SHA256 of a single 64-byte block that already contains the message padding. */
+template<TransformType tr>
+void TransformDSingleWrapper(unsigned char* out, const unsigned char* in)
+{
+    uint32_t s[8];
+    unsigned char buffer2[64] = {
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0
+    };
+    sha256::Initialize(s);
+    tr(s, in, 1);
+    WriteBE32(buffer2 + 0, s[0]);
+    WriteBE32(buffer2 + 4, s[1]);
+    WriteBE32(buffer2 + 8, s[2]);
+    WriteBE32(buffer2 + 12, s[3]);
+    WriteBE32(buffer2 + 16, s[4]);
+    WriteBE32(buffer2 + 20, s[5]);
+    WriteBE32(buffer2 + 24, s[6]);
+    WriteBE32(buffer2 + 28, s[7]);
+    sha256::Initialize(s);
+    tr(s, buffer2, 1);
+    WriteBE32(out + 0, s[0]);
+    WriteBE32(out + 4, s[1]);
+    WriteBE32(out + 8, s[2]);
+    WriteBE32(out + 12, s[3]);
+    WriteBE32(out + 16, s[4]);
+    WriteBE32(out + 20, s[5]);
+    WriteBE32(out + 24, s[6]);
+    WriteBE32(out + 28, s[7]);
+}
+
 TransformType Transform = sha256::Transform;
 TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformD64Type TransformDSingle = TransformDSingleWrapper<sha256::Transform>;
+TransformD64Type TransformDSingle_2way = nullptr;
+TransformD64Type TransformDSingle_4way = nullptr;
+TransformD64Type TransformDSingle_8way = nullptr;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -544,6 +584,32 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test the single block variants against the (already tested) 1-way Transform.
+    unsigned char result_single[256];
+    for (size_t i = 0; i < 8; ++i) {
+        TransformDSingleWrapper<sha256::Transform>(result_single + 32 * i, data + 1 + 64 * i);
+    }
+    TransformDSingle(out, data + 1);
+    if (!std::equal(out, out + 32, result_single)) return false;
+
+    if (TransformDSingle_2way) {
+        unsigned char out[64];
+        TransformDSingle_2way(out, data + 1);
+        if (!std::equal(out, out + 64, result_single)) return false;
+    }
+
+    if (TransformDSingle_4way) {
+        unsigned char out[128];
+        TransformDSingle_4way(out, data + 1);
+        if (!std::equal(out, out + 128, result_single)) return false;
+    }
+
+    if (TransformDSingle_8way) {
+        unsigned char out[256];
+        TransformDSingle_8way(out, data + 1);
+        if (!std::equal(out, out + 256, result_single)) return false;
+    }
+
     return true;
 }
 
@@ -597,6 +663,8 @@ std::string SHA256AutoDetect()
         Transform = sha256_shani::Transform;
         TransformD64 = TransformD64Wrapper<sha256_shani::Transform>;
         TransformD64_2way = sha256d64_shani::Transform_2way;
+        TransformDSingle = TransformDSingleWrapper<sha256_shani::Transform>;
+        TransformDSingle_2way = sha256d64_shani::TransformSingle_2way;
         ret = "shani(1way,2way)";
         have_sse4 = false; // Disable SSE4/AVX2;
         have_avx2 = false;
@@ -607,10 +675,12 @@ std::string SHA256AutoDetect()
 #if defined(__x86_64__) || defined(__amd64__)
         Transform = sha256_sse4::Transform;
         TransformD64 = TransformD64Wrapper<sha256_sse4::Transform>;
+        TransformDSingle = TransformDSingleWrapper<sha256_sse4::Transform>;
         ret = "sse4(1way)";
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        TransformDSingle_4way = sha256d64_sse41::TransformSingle_4way;
         ret += ",sse41(4way)";
 #endif
     }
@@ -618,6 +688,7 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformDSingle_8way = sha256d64_avx2::TransformSingle_8way;
         ret += ",avx2(8way)";
     }
 #endif
@@ -717,3 +788,37 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+void SHA256DSingleBlock(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    if (TransformDSingle_8way) {
+        while (blocks >= 8) {
+            TransformDSingle_8way(out, in);
+            out += 256;
+            in += 512;
+            blocks -= 8;
+        }
+    }
+    if (TransformDSingle_4way) {
+        while (blocks >= 4) {
+            TransformDSingle_4way(out, in);
+            out += 128;
+            in += 256;
+            blocks -= 4;
+        }
+    }
+    if (TransformDSingle_2way) {
+        while (blocks >= 2) {
+            TransformDSingle_2way(out, in);
+            out += 64;
+            in += 128;
+            blocks -= 2;
+        }
+    }
+    while (blocks) {
+        TransformDSingle(out, in);
+        out += 32;
+        in += 64;
+        --blocks;
+    }
+}
@@ -38,4 +38,13 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute multiple double-SHA256's of messages of at most 55 bytes, each
+ *  passed as one 64-byte block that already contains the SHA-256 padding
+ *  (the message, a 0x80 byte, zeroes and the big-endian 64-bit bit length).
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void SHA256DSingleBlock(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -141,7 +141,8 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
 
 namespace sha256d64_shani {
 
-void Transform_2way(unsigned char* out, const unsigned char* in)
+template <bool SINGLE_BLOCK>
+void inline __attribute__((always_inline)) TransformD_2way(unsigned char* out, const unsigned char* in)
 {
     __m128i am0, am1, am2, am3, as0, as1, aso0, aso1;
     __m128i bm0, bm1, bm2, bm3, bs0, bs1, bso0, bso1;
@@ -222,47 +223,51 @@ void Transform_2way(unsigned char* out, const unsigned char* in)
     as1 = _mm_add_epi32(as1, _mm_load_si128((const __m128i*)INIT1));
     bs1 = _mm_add_epi32(bs1, _mm_load_si128((const __m128i*)INIT1));
 
-    /* Transform 2 */
-    aso0 = as0;
-    bso0 = bs0;
-    aso1 = as1;
-    bso1 = bs1;
-    QuadRound(as0, as1, 0xe9b5dba5b5c0fbcfull, 0x71374491c28a2f98ull);
-    QuadRound(bs0, bs1, 0xe9b5dba5b5c0fbcfull, 0x71374491c28a2f98ull);
-    QuadRound(as0, as1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
-    QuadRound(bs0, bs1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
-    QuadRound(as0, as1, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
-    QuadRound(bs0, bs1, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
-    QuadRound(as0, as1, 0xc19bf3749bdc06a7ull, 0x80deb1fe72be5d74ull);
-    QuadRound(bs0, bs1, 0xc19bf3749bdc06a7ull, 0x80deb1fe72be5d74ull);
-    QuadRound(as0, as1, 0x240cf2540fe1edc6ull, 0xf0fe4786649b69c1ull);
-    QuadRound(bs0, bs1, 0x240cf2540fe1edc6ull, 0xf0fe4786649b69c1ull);
-    QuadRound(as0, as1, 0x16f988fa61b9411eull, 0x6cc984be4fe9346full);
-    QuadRound(bs0, bs1, 0x16f988fa61b9411eull, 0x6cc984be4fe9346full);
-    QuadRound(as0, as1, 0xb9d99ec7b019fc65ull, 0xa88e5a6df2c65152ull);
-    QuadRound(bs0, bs1, 0xb9d99ec7b019fc65ull, 0xa88e5a6df2c65152ull);
-    QuadRound(as0, as1, 0xc7353eb0fdb1232bull, 0xe70eeaa09a1231c3ull);
-    QuadRound(bs0, bs1, 0xc7353eb0fdb1232bull, 0xe70eeaa09a1231c3ull);
-    QuadRound(as0, as1, 0xdc1eeefd5a0f118full, 0xcb976d5f3069bad5ull);
-    QuadRound(bs0, bs1, 0xdc1eeefd5a0f118full, 0xcb976d5f3069bad5ull);
-    QuadRound(as0, as1, 0xe15d5b1658f4ca9dull, 0xde0b7a040a35b689ull);
-    QuadRound(bs0, bs1, 0xe15d5b1658f4ca9dull, 0xde0b7a040a35b689ull);
-    QuadRound(as0, as1, 0x6fab9537a507ea32ull, 0x37088980007f3e86ull);
-    QuadRound(bs0, bs1, 0x6fab9537a507ea32ull, 0x37088980007f3e86ull);
-    QuadRound(as0, as1, 0xc0bbbe37cdaa3b6dull, 0x0d8cd6f117406110ull);
-    QuadRound(bs0, bs1, 0xc0bbbe37cdaa3b6dull, 0x0d8cd6f117406110ull);
-    QuadRound(as0, as1, 0x6fd15ca70b02e931ull, 0xdb48a36383613bdaull);
-    QuadRound(bs0, bs1, 0x6fd15ca70b02e931ull, 0xdb48a36383613bdaull);
-    QuadRound(as0, as1, 0x6d4378906ed41a95ull, 0x31338431521afacaull);
-    QuadRound(bs0, bs1, 0x6d4378906ed41a95ull, 0x31338431521afacaull);
-    QuadRound(as0, as1, 0x532fb63cb5c9a0e6ull, 0x9eccabbdc39c91f2ull);
-    QuadRound(bs0, bs1, 0x532fb63cb5c9a0e6ull, 0x9eccabbdc39c91f2ull);
-    QuadRound(as0, as1, 0x4c191d76a4954b68ull, 0x07237ea3d2c741c6ull);
-    QuadRound(bs0, bs1, 0x4c191d76a4954b68ull, 0x07237ea3d2c741c6ull);
-    as0 = _mm_add_epi32(as0, aso0);
-    bs0 = _mm_add_epi32(bs0, bso0);
-    as1 = _mm_add_epi32(as1, aso1);
-    bs1 = _mm_add_epi32(bs1, bso1);
+    if (SINGLE_BLOCK) {
+        // The input blocks hold the whole padded messages
+    } else {
+        /* Transform 2 */
+        aso0 = as0;
+        bso0 = bs0;
+        aso1 = as1;
+        bso1 = bs1;
+        QuadRound(as0, as1, 0xe9b5dba5b5c0fbcfull, 0x71374491c28a2f98ull);
+        QuadRound(bs0, bs1, 0xe9b5dba5b5c0fbcfull, 0x71374491c28a2f98ull);
+        QuadRound(as0, as1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+        QuadRound(bs0, bs1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+        QuadRound(as0, as1, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+        QuadRound(bs0, bs1, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+        QuadRound(as0, as1, 0xc19bf3749bdc06a7ull, 0x80deb1fe72be5d74ull);
+        QuadRound(bs0, bs1, 0xc19bf3749bdc06a7ull, 0x80deb1fe72be5d74ull);
+        QuadRound(as0, as1, 0x240cf2540fe1edc6ull, 0xf0fe4786649b69c1ull);
+        QuadRound(bs0, bs1, 0x240cf2540fe1edc6ull, 0xf0fe4786649b69c1ull);
+        QuadRound(as0, as1, 0x16f988fa61b9411eull, 0x6cc984be4fe9346full);
+        QuadRound(bs0, bs1, 0x16f988fa61b9411eull, 0x6cc984be4fe9346full);
+        QuadRound(as0, as1, 0xb9d99ec7b019fc65ull, 0xa88e5a6df2c65152ull);
+        QuadRound(bs0, bs1, 0xb9d99ec7b019fc65ull, 0xa88e5a6df2c65152ull);
+        QuadRound(as0, as1, 0xc7353eb0fdb1232bull, 0xe70eeaa09a1231c3ull);
+        QuadRound(bs0, bs1, 0xc7353eb0fdb1232bull, 0xe70eeaa09a1231c3ull);
+        QuadRound(as0, as1, 0xdc1eeefd5a0f118full, 0xcb976d5f3069bad5ull);
+        QuadRound(bs0, bs1, 0xdc1eeefd5a0f118full, 0xcb976d5f3069bad5ull);
+        QuadRound(as0, as1, 0xe15d5b1658f4ca9dull, 0xde0b7a040a35b689ull);
+        QuadRound(bs0, bs1, 0xe15d5b1658f4ca9dull, 0xde0b7a040a35b689ull);
+        QuadRound(as0, as1, 0x6fab9537a507ea32ull, 0x37088980007f3e86ull);
+        QuadRound(bs0, bs1, 0x6fab9537a507ea32ull, 0x37088980007f3e86ull);
+        QuadRound(as0, as1, 0xc0bbbe37cdaa3b6dull, 0x0d8cd6f117406110ull);
+        QuadRound(bs0, bs1, 0xc0bbbe37cdaa3b6dull, 0x0d8cd6f117406110ull);
+        QuadRound(as0, as1, 0x6fd15ca70b02e931ull, 0xdb48a36383613bdaull);
+        QuadRound(bs0, bs1, 0x6fd15ca70b02e931ull, 0xdb48a36383613bdaull);
+        QuadRound(as0, as1, 0x6d4378906ed41a95ull, 0x31338431521afacaull);
+        QuadRound(bs0, bs1, 0x6d4378906ed41a95ull, 0x31338431521afacaull);
+        QuadRound(as0, as1, 0x532fb63cb5c9a0e6ull, 0x9eccabbdc39c91f2ull);
+        QuadRound(bs0, bs1, 0x532fb63cb5c9a0e6ull, 0x9eccabbdc39c91f2ull);
+        QuadRound(as0, as1, 0x4c191d76a4954b68ull, 0x07237ea3d2c741c6ull);
+        QuadRound(bs0, bs1, 0x4c191d76a4954b68ull, 0x07237ea3d2c741c6ull);
+        as0 = _mm_add_epi32(as0, aso0);
+        bs0 = _mm_add_epi32(bs0, bso0);
+        as1 = _mm_add_epi32(as1, aso1);
+        bs1 = _mm_add_epi32(bs1, bso1);
+    }
 
     /* Extract hash */
     Unshuffle(as0, as1);
@@ -351,6 +356,16 @@ void Transform_2way(unsigned char* out, const unsigned char* in)
     Save(out + 48, bs1);
 }
 
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    TransformD_2way<false>(out, in);
+}
+
+void TransformSingle_2way(unsigned char* out, const unsigned char* in)
+{
+    TransformD_2way<true>(out, in);
+}
+
 }
 
 #endif
@@ -131,6 +131,8 @@ public:
 
     void SeekToFirst();
 
+    void SeekToLast();
+
     template <typename K>
     void Seek(const K& key)
     {
@@ -143,6 +145,8 @@ public:
 
     void Next();
 
+    void Prev();
+
     template <typename K>
     bool GetKey(K& key)
     {
@@ -316,6 +320,24 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    //! Iterate over a snapshot taken with GetSnapshot instead of the current state
+    CDBIterator* NewIterator(const leveldb::Snapshot* snapshot) const
+    {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot = snapshot;
+        return new CDBIterator(*this, pdb->NewIterator(options));
+    }
+
+    const leveldb::Snapshot* GetSnapshot() const
+    {
+        return pdb->GetSnapshot();
+    }
+
+    void ReleaseSnapshot(const leveldb::Snapshot* snapshot) const
+    {
+        pdb->ReleaseSnapshot(snapshot);
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -354,4 +376,27 @@ public:
     }
 };
 
+/**
+ * A consistent view of a CDBWrapper as of its creation. Iterators made from
+ * one snapshot may be used from several threads at once.
+ */
+class CDBSnapshot
+{
+private:
+    const CDBWrapper& parent;
+    const leveldb::Snapshot* psnapshot;
+
+public:
+    explicit CDBSnapshot(const CDBWrapper& _parent) : parent(_parent), psnapshot(_parent.GetSnapshot()) {}
+    ~CDBSnapshot() { parent.ReleaseSnapshot(psnapshot); }
+
+    CDBSnapshot(const CDBSnapshot&) = delete;
+    CDBSnapshot& operator=(const CDBSnapshot&) = delete;
+
+    CDBIterator* NewIterator() const
+    {
+        return parent.NewIterator(psnapshot);
+    }
+};
+
 #endif // BITCOIN_DBWRAPPER_H
@@ -0,0 +1,708 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+
+#include <chainparams.h>
+#include <checkqueue.h>
+#include <hash.h>
+#include <shutdown.h>
+#include <txdb.h>
+#include <ui_interface.h>
+#include <undo.h>
+#include <util/system.h>
+#include <util/threadnames.h>
+#include <util/translation.h>
+#include <validation.h>
+
+#include <limits>
+#include <map>
+#include <queue>
+#include <set>
+#include <tuple>
+
+#include <boost/thread.hpp>
+
+constexpr char DB_ADDRESSINDEX = 'a';
+constexpr char DB_ADDRESSUNSPENTINDEX = 'u';
+constexpr char DB_ADDRESSBALANCE = 'e';
+constexpr char DB_ADDRESSBALANCE_BUILT = 'E';
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+bool GetAddressIndexKey(const CScript& script, int& type, uint256& hash)
+{
+    std::vector<unsigned char> addressBytes(32);
+    if (script.IsPayToScriptHash()) {
+        std::copy(script.begin() + 2, script.begin() + 22, addressBytes.begin());
+        type = 2;
+    } else if (script.IsPayToPublicKeyHash()) {
+        std::copy(script.begin() + 3, script.begin() + 23, addressBytes.begin());
+        type = 1;
+    } else if (script.IsPayToPubkey()) {
+        std::vector<unsigned char> pubkeyBytes(script.begin() + 1, script.end() - 1);
+        uint160 hashBytes = Hash160(pubkeyBytes);
+        std::copy(hashBytes.begin(), hashBytes.end(), addressBytes.begin());
+        type = 1;
+    } else if (script.IsPayToWitnessPubkeyHash()) {
+        std::copy(script.begin() + 2, script.end(), addressBytes.begin());
+        type = 4;
+    } else if (script.IsPayToWitnessScriptHash()) {
+        std::copy(script.begin() + 2, script.end(), addressBytes.begin());
+        type = 3;
+    } else {
+        return false;
+    }
+    hash = uint256(addressBytes);
+    return true;
+}
+
+/**
+ * Collect the address index entries and unspent output changes of a block,
+ * as connecting it writes them, or as disconnecting it erases and restores
+ * them. The spent outputs come from the undo data of the block.
+ */
+static bool GetBlockAddressIndex(const CBlock& block, const CBlockUndo& block_undo, int nHeight, bool fDisconnect,
+                                 std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& addressUnspentIndex)
+{
+    if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: block and undo data inconsistent", __func__);
+    }
+
+    for (size_t n = 0; n < block.vtx.size(); n++) {
+        // Disconnecting undoes the transactions in reverse order, so that the
+        // outputs spent within the block end up erased from the unspent index
+        const size_t i = fDisconnect ? block.vtx.size() - 1 - n : n;
+        const CTransaction& tx = *block.vtx[i];
+        const uint256 txhash = tx.GetHash();
+        int type;
+        uint256 addressHash;
+
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut& out = tx.vout[k];
+            if (!GetAddressIndexKey(out.scriptPubKey, type, addressHash))
+                continue;
+
+            // receiving activity, and the unspent output
+            addressIndex.push_back(std::make_pair(CAddressIndexKey(type, addressHash, nHeight, i, txhash, k, false), out.nValue));
+            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(type, addressHash, txhash, k), fDisconnect ? CAddressUnspentValue() : CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+        }
+
+        if (i == 0)
+            continue;
+        const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+        if (tx_undo.vprevout.size() != tx.vin.size()) {
+            return error("%s: transaction and undo data inconsistent", __func__);
+        }
+        for (unsigned int j = 0; j < tx.vin.size(); j++) {
+            const COutPoint& prevout = tx.vin[j].prevout;
+            const Coin& coin = tx_undo.vprevout[j];
+            if (!GetAddressIndexKey(coin.out.scriptPubKey, type, addressHash))
+                continue;
+
+            // spending activity, and the output leaving (or returning to) the unspent index
+            addressIndex.push_back(std::make_pair(CAddressIndexKey(type, addressHash, nHeight, i, txhash, j, true), coin.out.nValue * -1));
+            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(type, addressHash, prevout.hash, prevout.n), fDisconnect ? CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight) : CAddressUnspentValue()));
+        }
+    }
+    return true;
+}
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+bool AddressIndex::Init()
+{
+    LOCK(cs_main);
+
+    // Older nodes kept the address index in the block tree database, written
+    // while connecting blocks. Move it here, and sum the balances of entries
+    // written before the balances existed.
+    if (!m_db->MigrateLegacyData(*pblocktree, "addressindex", {DB_ADDRESSINDEX, DB_ADDRESSUNSPENTINDEX, DB_ADDRESSBALANCE}, ::ChainActive().GetLocator())) {
+        return false;
+    }
+    if (!m_db->BuildAddressBalances()) {
+        return false;
+    }
+
+    return BaseIndex::Init();
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+
+    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> addressUnspentIndex;
+    if (!GetBlockAddressIndex(block, block_undo, pindex->nHeight, false, addressIndex, addressUnspentIndex)) {
+        return false;
+    }
+    return m_db->WriteAddressIndex(addressIndex) && m_db->UpdateAddressUnspentIndex(addressUnspentIndex);
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // Undo the blocks leaving the chain from the tip down, as the chainstate
+    // disconnects them
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+        CBlockUndo block_undo;
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: Failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> addressUnspentIndex;
+        if (!GetBlockAddressIndex(block, block_undo, pindex->nHeight, true, addressIndex, addressUnspentIndex) ||
+            !m_db->EraseAddressIndex(addressIndex) || !m_db->UpdateAddressUnspentIndex(addressUnspentIndex)) {
+            return false;
+        }
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::ReadAddressIndex(const uint256& addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start, int end) const
+{
+    return m_db->ReadAddressIndex(addressHash, type, addressIndex, start, end);
+}
+
+bool AddressIndex::ReadAddressIndexBatch(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start, int end) const
+{
+    return m_db->ReadAddressIndexBatch(addresses, addressIndex, start, end);
+}
+
+bool AddressIndex::IterateAddressIndex(const uint256& addressHash, int type, const std::function<bool(const CAddressIndexKey&, CAmount)>& visitor, const CAddressIndexKey* pkeyAfter, bool fDescending, int start, int end) const
+{
+    return m_db->IterateAddressIndex(addressHash, type, visitor, pkeyAfter, fDescending, start, end);
+}
+
+bool AddressIndex::ReadAddressUnspentIndex(const uint256& addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs) const
+{
+    return m_db->ReadAddressUnspentIndex(addressHash, type, unspentOutputs);
+}
+
+bool AddressIndex::ReadAddressUnspentIndexBatch(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs) const
+{
+    return m_db->ReadAddressUnspentIndexBatch(addresses, unspentOutputs);
+}
+
+bool AddressIndex::IterateAddressUnspentIndex(const uint256& addressHash, int type, const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& visitor, const CAddressUnspentKey* pkeyAfter, bool fDescending) const
+{
+    return m_db->IterateAddressUnspentIndex(addressHash, type, visitor, pkeyAfter, fDescending);
+}
+
+bool AddressIndex::ReadAddressBalance(const uint256& addressHash, int type, CAddressBalance& balance) const
+{
+    return m_db->ReadAddressBalance(addressHash, type, balance);
+}
+
+bool AddressIndex::DB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& vect)
+{
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>::const_iterator it = vect.begin(); it != vect.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+/**
+ * Move an iterator that was seeked to the key bounding a walk over part of
+ * an address index onto the first entry of the walk. Walks after a key start
+ * past that key, descending walks start at the last entry before the seek key.
+ */
+template <typename K>
+static void SeekAddressIndexStart(CDBIterator& cursor, const K* pkeyAfter, bool fDescending)
+{
+    if (fDescending) {
+        if (cursor.Valid()) {
+            cursor.Prev();
+        } else {
+            cursor.SeekToLast();
+        }
+    } else if (pkeyAfter && cursor.Valid()) {
+        std::pair<char, K> key;
+        if (cursor.GetKey(key) && key.second == *pkeyAfter) {
+            cursor.Next();
+        }
+    }
+}
+
+bool AddressIndex::DB::ReadAddressUnspentIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs)
+{
+    return IterateAddressUnspentIndex(addressHash, type, [&unspentOutputs](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+        unspentOutputs.push_back(std::make_pair(key, value));
+        return true;
+    });
+}
+
+static bool WalkAddressUnspentIndex(CDBIterator& cursor, const uint256& addressHash, int type, const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& visitor, const CAddressUnspentKey* pkeyAfter, bool fDescending)
+{
+    if (pkeyAfter) {
+        cursor.Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, *pkeyAfter));
+    } else if (!fDescending) {
+        cursor.Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    } else {
+        uint256 txhashMax;
+        memset(txhashMax.begin(), 0xff, txhashMax.size());
+        cursor.Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, addressHash, txhashMax, std::numeric_limits<uint32_t>::max())));
+    }
+    SeekAddressIndexStart(cursor, pkeyAfter, fDescending);
+
+    while (cursor.Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressUnspentKey> key;
+        if (cursor.GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.type == (unsigned int)type && key.second.hashBytes == addressHash) {
+            CAddressUnspentValue nValue;
+            if (cursor.GetValue(nValue)) {
+                if (!visitor(key.second, nValue)) {
+                    break;
+                }
+                if (fDescending) {
+                    cursor.Prev();
+                } else {
+                    cursor.Next();
+                }
+            } else {
+                return error("failed to get address unspent value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::IterateAddressUnspentIndex(uint256 addressHash, int type, const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& visitor, const CAddressUnspentKey* pkeyAfter, bool fDescending)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    return WalkAddressUnspentIndex(*pcursor, addressHash, type, visitor, pkeyAfter, fDescending);
+}
+
+namespace {
+
+typedef std::tuple<int, unsigned int, uint256, size_t, bool> AddressIndexEntry;
+
+/** The address index entries of one address written or erased by one batch */
+struct AddressIndexChange {
+    CAmount balance{0};
+    CAmount received{0};
+    std::set<uint256> txids;
+    std::set<AddressIndexEntry> entries;
+};
+
+typedef std::map<std::pair<unsigned int, uint256>, AddressIndexChange> AddressIndexChanges;
+
+AddressIndexEntry GetAddressIndexEntry(const CAddressIndexKey& key)
+{
+    return std::make_tuple(key.blockHeight, key.txindex, key.txhash, key.index, key.spending);
+}
+
+void AddAddressIndexChange(AddressIndexChanges& changes, const CAddressIndexKey& key, CAmount nValue)
+{
+    AddressIndexChange& change = changes[std::make_pair(key.type, key.hashBytes)];
+    if (!change.entries.insert(GetAddressIndexEntry(key)).second)
+        return;
+    change.balance += nValue;
+    if (nValue > 0)
+        change.received += nValue;
+    change.txids.insert(key.txhash);
+}
+
+/**
+ * Find the height of the first (or last) address index entry of an address
+ * that is not one of the entries being erased. Returns -1 if there is none.
+ */
+int FindAddressIndexHeight(CDBWrapper& db, unsigned int type, const uint256& addressHash, const std::set<AddressIndexEntry>& erased, bool fFirst)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    if (fFirst) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, std::numeric_limits<int>::max())));
+        if (pcursor->Valid()) {
+            pcursor->Prev();
+        } else {
+            pcursor->SeekToLast();
+        }
+    }
+
+    while (pcursor->Valid()) {
+        std::pair<char, CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX || key.second.type != type || key.second.hashBytes != addressHash)
+            break;
+        if (!erased.count(GetAddressIndexEntry(key.second)))
+            return key.second.blockHeight;
+        if (fFirst) {
+            pcursor->Next();
+        } else {
+            pcursor->Prev();
+        }
+    }
+    return -1;
+}
+
+/** Apply the changes to the address balances, in the same batch as the entries themselves */
+void UpdateAddressBalances(CDBWrapper& db, CDBBatch& batch, const AddressIndexChanges& changes, bool fErase)
+{
+    for (AddressIndexChanges::const_iterator it = changes.begin(); it != changes.end(); it++) {
+        const unsigned int type = it->first.first;
+        const uint256& addressHash = it->first.second;
+        const AddressIndexChange& change = it->second;
+        const int nFirstHeight = std::get<0>(*change.entries.begin());
+        const int nLastHeight = std::get<0>(*change.entries.rbegin());
+
+        CAddressBalance balance;
+        if (!db.Read(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), balance))
+            balance.SetNull();
+
+        if (!fErase) {
+            balance.balance += change.balance;
+            balance.received += change.received;
+            balance.txCount += change.txids.size();
+            if (balance.firstHeight < 0 || nFirstHeight < balance.firstHeight)
+                balance.firstHeight = nFirstHeight;
+            if (nLastHeight > balance.lastHeight)
+                balance.lastHeight = nLastHeight;
+        } else {
+            balance.balance -= change.balance;
+            balance.received -= change.received;
+            balance.txCount -= std::min<uint32_t>(balance.txCount, change.txids.size());
+            if (balance.IsNull()) {
+                batch.Erase(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)));
+                continue;
+            }
+            if (nFirstHeight <= balance.firstHeight)
+                balance.firstHeight = FindAddressIndexHeight(db, type, addressHash, change.entries, true);
+            if (nLastHeight >= balance.lastHeight)
+                balance.lastHeight = FindAddressIndexHeight(db, type, addressHash, change.entries, false);
+        }
+        batch.Write(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), balance);
+    }
+}
+
+} // namespace
+
+bool AddressIndex::DB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount>>& vect)
+{
+    CDBBatch batch(*this);
+    AddressIndexChanges changes;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount>>::const_iterator it = vect.begin(); it != vect.end(); it++) {
+        // Entries that are already indexed, as when the chainstate is
+        // reindexed, are already part of the address balance
+        if (!Exists(std::make_pair(DB_ADDRESSINDEX, it->first)))
+            AddAddressIndexChange(changes, it->first, it->second);
+        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    }
+    UpdateAddressBalances(*this, batch, changes, false);
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount>>& vect)
+{
+    CDBBatch batch(*this);
+    AddressIndexChanges changes;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount>>::const_iterator it = vect.begin(); it != vect.end(); it++) {
+        if (Exists(std::make_pair(DB_ADDRESSINDEX, it->first)))
+            AddAddressIndexChange(changes, it->first, it->second);
+        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
+    }
+    UpdateAddressBalances(*this, batch, changes, true);
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::ReadAddressBalance(uint256 addressHash, int type, CAddressBalance& balance)
+{
+    return Read(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), balance);
+}
+
+bool AddressIndex::DB::BuildAddressBalances()
+{
+    if (Exists(DB_ADDRESSBALANCE_BUILT))
+        return true;
+
+    // Address index entries written without their address balances, as moved
+    // from the block tree database, get them summed one address at a time
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(DB_ADDRESSINDEX);
+
+    int64_t count = 0;
+    LogPrintf("Building address balance index...\n");
+    LogPrintf("[0%%]..."); /* Continued */
+    uiInterface.ShowProgress(_("Building address balance index").translated, 0, true);
+    size_t batch_size = 1 << 24;
+    CDBBatch batch(*this);
+    int reportDone = 0;
+    bool fAddress = false;
+    CAddressIndexIteratorKey address;
+    CAddressBalance balance;
+    uint256 txhashLast;
+    std::pair<char, CAddressIndexKey> key;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested()) {
+            break;
+        }
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX) {
+            break;
+        }
+        if (!fAddress || key.second.type != address.type || key.second.hashBytes != address.hashBytes) {
+            if (fAddress) {
+                batch.Write(std::make_pair(DB_ADDRESSBALANCE, address), balance);
+            }
+            if (batch.SizeEstimate() > batch_size) {
+                WriteBatch(batch);
+                batch.Clear();
+            }
+            if (count++ % 256 == 0) {
+                int percentageDone = std::min(99, (int)((std::max(1u, key.second.type) - 1) * 25 + *key.second.hashBytes.begin() * 25 / 256));
+                uiInterface.ShowProgress(_("Building address balance index").translated, percentageDone, true);
+                if (reportDone < percentageDone / 10) {
+                    // report max. every 10% step
+                    LogPrintf("[%d%%]...", percentageDone); /* Continued */
+                    reportDone = percentageDone / 10;
+                }
+            }
+            fAddress = true;
+            address = CAddressIndexIteratorKey(key.second.type, key.second.hashBytes);
+            balance.SetNull();
+        }
+
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue)) {
+            return error("%s: failed to get address index value", __func__);
+        }
+        balance.balance += nValue;
+        if (nValue > 0) {
+            balance.received += nValue;
+        }
+        // The entries of one transaction are adjacent in the index
+        if (balance.txCount == 0 || key.second.txhash != txhashLast) {
+            balance.txCount++;
+            txhashLast = key.second.txhash;
+        }
+        if (balance.firstHeight < 0) {
+            balance.firstHeight = key.second.blockHeight;
+        }
+        balance.lastHeight = key.second.blockHeight;
+        pcursor->Next();
+    }
+    if (fAddress && !ShutdownRequested()) {
+        batch.Write(std::make_pair(DB_ADDRESSBALANCE, address), balance);
+    }
+    WriteBatch(batch);
+    uiInterface.ShowProgress("", 100, false);
+    LogPrintf("[%s].\n", ShutdownRequested() ? "CANCELLED" : "DONE");
+    if (ShutdownRequested()) {
+        return false;
+    }
+    return Write(DB_ADDRESSBALANCE_BUILT, true);
+}
+
+bool AddressIndex::DB::ReadAddressIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start, int end)
+{
+    return IterateAddressIndex(addressHash, type, [&addressIndex](const CAddressIndexKey& key, CAmount nValue) {
+        addressIndex.push_back(std::make_pair(key, nValue));
+        return true;
+    }, nullptr, false, start, end);
+}
+
+static bool WalkAddressIndex(CDBIterator& cursor, const uint256& addressHash, int type, const std::function<bool(const CAddressIndexKey&, CAmount)>& visitor, const CAddressIndexKey* pkeyAfter, bool fDescending, int start, int end)
+{
+    // A cursor from outside of the height range starts at its beginning
+    if (pkeyAfter && start > 0 && end > 0 && (fDescending ? pkeyAfter->blockHeight > end : pkeyAfter->blockHeight < start)) {
+        pkeyAfter = nullptr;
+    }
+
+    if (pkeyAfter) {
+        cursor.Seek(std::make_pair(DB_ADDRESSINDEX, *pkeyAfter));
+    } else if (fDescending) {
+        cursor.Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start > 0 && end > 0 ? end + 1 : std::numeric_limits<int>::max())));
+    } else if (start > 0 && end > 0) {
+        cursor.Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
+    } else {
+        cursor.Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+    SeekAddressIndexStart(cursor, pkeyAfter, fDescending);
+
+    while (cursor.Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressIndexKey> key;
+        if (cursor.GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.type == (unsigned int)type && key.second.hashBytes == addressHash) {
+            if (fDescending ? start > 0 && key.second.blockHeight < start : end > 0 && key.second.blockHeight > end) {
+                break;
+            }
+            CAmount nValue;
+            if (cursor.GetValue(nValue)) {
+                if (!visitor(key.second, nValue)) {
+                    break;
+                }
+                if (fDescending) {
+                    cursor.Prev();
+                } else {
+                    cursor.Next();
+                }
+            } else {
+                return error("failed to get address index value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::IterateAddressIndex(uint256 addressHash, int type, const std::function<bool(const CAddressIndexKey&, CAmount)>& visitor, const CAddressIndexKey* pkeyAfter, bool fDescending, int start, int end)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    return WalkAddressIndex(*pcursor, addressHash, type, visitor, pkeyAfter, fDescending, start, end);
+}
+
+namespace {
+
+/** The read of one address of a batched address index lookup */
+class CAddressIndexRead
+{
+private:
+    std::function<bool()> read;
+
+public:
+    CAddressIndexRead() {}
+    explicit CAddressIndexRead(std::function<bool()> readIn) : read(std::move(readIn)) {}
+
+    bool operator()()
+    {
+        return read();
+    }
+
+    void swap(CAddressIndexRead& check)
+    {
+        read.swap(check.read);
+    }
+};
+
+/**
+ * Merge lists that are each in height order into one list in height order.
+ * Entries of equal height keep the order of their lists.
+ */
+template <typename T, typename HeightKey>
+void MergeByHeight(std::vector<std::vector<T>>& vLists, std::vector<T>& vMerged, HeightKey heightKey)
+{
+    typedef std::tuple<decltype(heightKey(std::declval<T>())), size_t, size_t> Head;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    size_t nTotal = 0;
+    for (size_t i = 0; i < vLists.size(); i++) {
+        nTotal += vLists[i].size();
+        if (!vLists[i].empty())
+            heads.emplace(heightKey(vLists[i][0]), i, 0);
+    }
+    vMerged.reserve(vMerged.size() + nTotal);
+    while (!heads.empty()) {
+        const size_t nList = std::get<1>(heads.top());
+        const size_t nPos = std::get<2>(heads.top());
+        heads.pop();
+        vMerged.push_back(std::move(vLists[nList][nPos]));
+        if (nPos + 1 < vLists[nList].size())
+            heads.emplace(heightKey(vLists[nList][nPos + 1]), nList, nPos + 1);
+    }
+}
+
+} // namespace
+
+static CCheckQueue<CAddressIndexRead> addressindexqueue(16);
+
+void ThreadAddressIndexRead(int worker_num)
+{
+    util::ThreadRename(strprintf("addrindex.%i", worker_num));
+    addressindexqueue.Thread();
+}
+
+// Run the reads on the address index workers, and on this thread
+static bool RunAddressIndexReads(std::vector<CAddressIndexRead>& vReads)
+{
+    CCheckQueueControl<CAddressIndexRead> control(&addressindexqueue);
+    control.Add(vReads);
+    return control.Wait();
+}
+
+bool AddressIndex::DB::ReadAddressIndexBatch(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start, int end)
+{
+    const CDBSnapshot snapshot(*this);
+    std::vector<std::vector<std::pair<CAddressIndexKey, CAmount>>> vResults(addresses.size());
+    std::vector<CAddressIndexRead> vReads;
+    vReads.reserve(addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++) {
+        vReads.emplace_back([&snapshot, &addresses, &vResults, i, start, end]() {
+            std::unique_ptr<CDBIterator> pcursor(snapshot.NewIterator());
+            return WalkAddressIndex(*pcursor, addresses[i].first, addresses[i].second, [&vResults, i](const CAddressIndexKey& key, CAmount nValue) {
+                vResults[i].push_back(std::make_pair(key, nValue));
+                return true;
+            }, nullptr, false, start, end);
+        });
+    }
+    if (!RunAddressIndexReads(vReads))
+        return error("failed to read address index");
+
+    MergeByHeight(vResults, addressIndex, [](const std::pair<CAddressIndexKey, CAmount>& entry) {
+        return std::make_pair(entry.first.blockHeight, entry.first.txindex);
+    });
+    return true;
+}
+
+bool AddressIndex::DB::ReadAddressUnspentIndexBatch(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs)
+{
+    const CDBSnapshot snapshot(*this);
+    std::vector<std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>> vResults(addresses.size());
+    std::vector<CAddressIndexRead> vReads;
+    vReads.reserve(addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++) {
+        vReads.emplace_back([&snapshot, &addresses, &vResults, i]() {
+            std::unique_ptr<CDBIterator> pcursor(snapshot.NewIterator());
+            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& vResult = vResults[i];
+            bool fOk = WalkAddressUnspentIndex(*pcursor, addresses[i].first, addresses[i].second, [&vResult](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+                vResult.push_back(std::make_pair(key, value));
+                return true;
+            }, nullptr, false);
+            // The unspent index is ordered by txid, not height
+            std::stable_sort(vResult.begin(), vResult.end(), [](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& a, const std::pair<CAddressUnspentKey, CAddressUnspentValue>& b) {
+                return a.second.blockHeight < b.second.blockHeight;
+            });
+            return fOk;
+        });
+    }
+    if (!RunAddressIndexReads(vReads))
+        return error("failed to read address unspent index");
+
+    MergeByHeight(vResults, unspentOutputs, [](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& entry) {
+        return entry.second.blockHeight;
+    });
+    return true;
+}
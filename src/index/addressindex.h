@@ -0,0 +1,107 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <addressindex.h>
+#include <index/base.h>
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class CBlockUndo;
+
+//! -addressindexthreads default, threads reading the address index besides the RPC thread
+static const int DEFAULT_ADDRESSINDEX_THREADS = 3;
+//! Maximum number of address index threads
+static const int MAX_ADDRESSINDEX_THREADS = 16;
+
+/**
+ * Find the address a script pays to, as the address index keys it: its type
+ * (1 P2PKH or P2PK, 2 P2SH, 3 P2WSH, 4 P2WPKH) and its hash. Returns false for
+ * scripts that pay to no such address.
+ */
+bool GetAddressIndexKey(const CScript& script, int& type, uint256& hash);
+
+/**
+ * AddressIndex is used to look up the history, the unspent outputs and the
+ * balance of an address. For every address it records each output paying to
+ * it and each input spending from it, the outputs that are still unspent and
+ * running totals of its history.
+ */
+class AddressIndex final : public BaseIndex
+{
+public:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    /// Override base class init to migrate from the block tree database.
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    bool ReadAddressIndex(const uint256& addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start = 0, int end = 0) const;
+    bool ReadAddressIndexBatch(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start = 0, int end = 0) const;
+    bool IterateAddressIndex(const uint256& addressHash, int type, const std::function<bool(const CAddressIndexKey&, CAmount)>& visitor, const CAddressIndexKey* pkeyAfter = nullptr, bool fDescending = false, int start = 0, int end = 0) const;
+    bool ReadAddressUnspentIndex(const uint256& addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs) const;
+    bool ReadAddressUnspentIndexBatch(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs) const;
+    bool IterateAddressUnspentIndex(const uint256& addressHash, int type, const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& visitor, const CAddressUnspentKey* pkeyAfter = nullptr, bool fDescending = false) const;
+    bool ReadAddressBalance(const uint256& addressHash, int type, CAddressBalance& balance) const;
+};
+
+/**
+ * Access to the address index database (indexes/addressindex/)
+ *
+ * Declared here rather than privately so that the entries can be written and
+ * read back without a chain, as the unit tests and benchmarks do.
+ */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& vect);
+    bool ReadAddressUnspentIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& vect);
+    //! Read the unspent outputs of several addresses in parallel, merged by height
+    bool ReadAddressUnspentIndexBatch(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs);
+    //! Visit the unspent outputs of an address in key order, after pkeyAfter if given, until the visitor returns false
+    bool IterateAddressUnspentIndex(uint256 addressHash, int type, const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& visitor, const CAddressUnspentKey* pkeyAfter = nullptr, bool fDescending = false);
+    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount>>& vect);
+    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount>>& vect);
+    bool ReadAddressIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start = 0, int end = 0);
+    //! Read the address index entries of several addresses in parallel, merged by height
+    bool ReadAddressIndexBatch(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start = 0, int end = 0);
+    //! Visit the address index entries of an address in key order, after pkeyAfter if given, until the visitor returns false
+    bool IterateAddressIndex(uint256 addressHash, int type, const std::function<bool(const CAddressIndexKey&, CAmount)>& visitor, const CAddressIndexKey* pkeyAfter = nullptr, bool fDescending = false, int start = 0, int end = 0);
+    bool ReadAddressBalance(uint256 addressHash, int type, CAddressBalance& balance);
+    //! Build the address balances of entries written without them, as moved from the block tree database
+    bool BuildAddressBalances();
+};
+
+/** Address index worker, running the reads of batched address index lookups */
+void ThreadAddressIndexRead(int worker_num);
+
+/// The global address index, used by the address RPCs. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
@@ -6,12 +6,14 @@
 #include <index/base.h>
 #include <shutdown.h>
 #include <tinyformat.h>
+#include <txdb.h>
 #include <ui_interface.h>
 #include <util/system.h>
 #include <validation.h>
 #include <warnings.h>
 
 constexpr char DB_BEST_BLOCK = 'B';
+constexpr char DB_LEGACY_INDEX_BLOCK = 'L';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
@@ -46,6 +48,102 @@ void BaseIndex::DB::WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator
     batch.Write(DB_BEST_BLOCK, locator);
 }
 
+namespace {
+
+/** A database key or value copied as is, without knowing its type */
+struct RawEntry {
+    std::vector<unsigned char> data;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s.write((const char*)data.data(), data.size());
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        data.resize(s.size());
+        s.read((char*)data.data(), data.size());
+    }
+};
+
+} // namespace
+
+bool BaseIndex::DB::MigrateLegacyData(CBlockTreeDB& block_tree_db, const std::string& name,
+                                      const std::vector<char>& prefixes, const CBlockLocator& best_locator)
+{
+    // Like the txindex migration, the boolean DB flag of the legacy index is first
+    // traded for the locator of the chain it is in sync with, so that a migration
+    // interrupted by a shutdown picks up where it left off. Without the flag, the
+    // legacy index was not maintained by the last run and its entries are stale.
+    bool f_legacy_flag = false;
+    block_tree_db.ReadFlag(name, f_legacy_flag);
+    if (f_legacy_flag) {
+        if (!block_tree_db.Write(std::make_pair(DB_LEGACY_INDEX_BLOCK, name), best_locator)) {
+            return error("%s: cannot write block indicator", __func__);
+        }
+        if (!block_tree_db.WriteFlag(name, false)) {
+            return error("%s: cannot write block index db flag", __func__);
+        }
+    }
+
+    CBlockLocator locator;
+    const bool f_move = block_tree_db.Read(std::make_pair(DB_LEGACY_INDEX_BLOCK, name), locator);
+
+    const size_t batch_size = 1 << 24; // 16 MiB
+    int64_t count = 0;
+    for (const char prefix : prefixes) {
+        CDBBatch batch_newdb(*this);
+        CDBBatch batch_olddb(block_tree_db);
+        std::unique_ptr<CDBIterator> cursor(block_tree_db.NewIterator());
+        for (cursor->Seek(prefix); cursor->Valid(); cursor->Next()) {
+            if (ShutdownRequested()) {
+                LogPrintf("Moving %s out of the block index database... [CANCELLED].\n", name);
+                return false;
+            }
+            RawEntry key;
+            if (!cursor->GetKey(key) || key.data.empty() || (char)key.data[0] != prefix) {
+                break;
+            }
+            if (f_move) {
+                RawEntry value;
+                if (!cursor->GetValue(value)) {
+                    return error("%s: cannot read %s record", __func__, name);
+                }
+                batch_newdb.Write(key, value);
+            }
+            batch_olddb.Erase(key);
+            if (count++ == 0) {
+                LogPrintf("%s %s entries of the block index database...\n", f_move ? "Moving" : "Deleting stale", name);
+            }
+
+            if (batch_newdb.SizeEstimate() > batch_size || batch_olddb.SizeEstimate() > batch_size) {
+                // Sync new DB changes to disk before deleting from old DB.
+                WriteBatch(batch_newdb, /*fSync=*/ true);
+                block_tree_db.WriteBatch(batch_olddb);
+                batch_newdb.Clear();
+                batch_olddb.Clear();
+            }
+        }
+        WriteBatch(batch_newdb, /*fSync=*/ true);
+        block_tree_db.WriteBatch(batch_olddb);
+        block_tree_db.CompactRange(prefix, (char)(prefix + 1));
+    }
+
+    if (f_move) {
+        CDBBatch batch(*this);
+        WriteBestBlock(batch, locator);
+        if (!WriteBatch(batch, /*fSync=*/ true) || !block_tree_db.Erase(std::make_pair(DB_LEGACY_INDEX_BLOCK, name))) {
+            return error("%s: cannot write %s best block", __func__, name);
+        }
+    }
+    if (count > 0) {
+        LogPrintf("%s %d %s entries of the block index database [DONE].\n", f_move ? "Moved" : "Deleted", count, name);
+    }
+    return true;
+}
+
 BaseIndex::~BaseIndex()
 {
     Interrupt();
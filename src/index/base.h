@@ -12,6 +12,7 @@
 #include <validationinterface.h>
 
 class CBlockIndex;
+class CBlockTreeDB;
 
 /**
  * Base class for indices of blockchain data. This implements
@@ -32,6 +33,12 @@ protected:
 
         /// Write block locator of the chain that the txindex is in sync with.
         void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator);
+
+        /// Move the entries under the given key prefixes out of the block tree DB, where indexes
+        /// kept them before they had a database of their own. Entries of an index that was not in
+        /// sync with best_locator are dropped instead. Returns false if interrupted.
+        bool MigrateLegacyData(CBlockTreeDB& block_tree_db, const std::string& name,
+                               const std::vector<char>& prefixes, const CBlockLocator& best_locator);
     };
 
 private:
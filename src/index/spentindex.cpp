@@ -0,0 +1,135 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+#include <index/spentindex.h>
+
+#include <chainparams.h>
+#include <txdb.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+constexpr char DB_SPENTINDEX = 'p';
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+/** Access to the spent index database (indexes/spentindex/) */
+class SpentIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+
+    /// Write a batch of spending inputs to the DB, erasing the outputs with a null value.
+    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>>& vect);
+};
+
+SpentIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "spentindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool SpentIndex::DB::ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    return Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
+
+bool SpentIndex::DB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>>& vect)
+{
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>>::const_iterator it = vect.begin(); it != vect.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
+        } else {
+            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+SpentIndex::SpentIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<SpentIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+SpentIndex::~SpentIndex() {}
+
+bool SpentIndex::Init()
+{
+    LOCK(cs_main);
+
+    // Older nodes kept the spent index in the block tree database, written
+    // while connecting blocks.
+    if (!m_db->MigrateLegacyData(*pblocktree, "spentindex", {DB_SPENTINDEX}, ::ChainActive().GetLocator())) {
+        return false;
+    }
+
+    return BaseIndex::Init();
+}
+
+bool SpentIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    // The amounts and addresses of the spent outputs come from the undo data
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+    if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: block and undo data inconsistent", __func__);
+    }
+
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>> spentIndex;
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+        if (tx_undo.vprevout.size() != tx.vin.size()) {
+            return error("%s: transaction and undo data inconsistent", __func__);
+        }
+        for (unsigned int j = 0; j < tx.vin.size(); j++) {
+            const COutPoint& prevout = tx.vin[j].prevout;
+            const CTxOut& out = tx_undo.vprevout[j].out;
+            int addressType = 0;
+            uint256 addressHash;
+            if (!GetAddressIndexKey(out.scriptPubKey, addressType, addressHash)) {
+                addressType = 0;
+                addressHash.SetNull();
+            }
+            spentIndex.push_back(std::make_pair(CSpentIndexKey(prevout.hash, prevout.n), CSpentIndexValue(tx.GetHash(), j, pindex->nHeight, out.nValue, addressType, addressHash)));
+        }
+    }
+    return m_db->UpdateSpentIndex(spentIndex);
+}
+
+bool SpentIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // The outputs spent by the blocks leaving the chain are unspent again
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>> spentIndex;
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+        for (size_t i = 1; i < block.vtx.size(); i++) {
+            for (const CTxIn& txin : block.vtx[i]->vin)
+                spentIndex.push_back(std::make_pair(CSpentIndexKey(txin.prevout.hash, txin.prevout.n), CSpentIndexValue()));
+        }
+    }
+    if (!m_db->UpdateSpentIndex(spentIndex)) {
+        return false;
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& SpentIndex::GetDB() const { return *m_db; }
+
+bool SpentIndex::FindSpent(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    return m_db->ReadSpentIndex(key, value);
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_SPENTINDEX_H
+#define BITCOIN_INDEX_SPENTINDEX_H
+
+#include <index/base.h>
+#include <spentindex.h>
+
+#include <memory>
+
+/**
+ * SpentIndex is used to look up the input spending an output. The index is
+ * written to a LevelDB database and records, by outpoint, the transaction and
+ * input spending it along with the amount and address of the output.
+ */
+class SpentIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    /// Override base class init to migrate from the block tree database.
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~SpentIndex() override;
+
+    /// Look up the input spending an output. Returns false if the output is
+    /// unspent or not indexed.
+    bool FindSpent(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+};
+
+/// The global spent index, used by the spent info RPCs. May be null.
+extern std::unique_ptr<SpentIndex> g_spentindex;
+
+#endif // BITCOIN_INDEX_SPENTINDEX_H
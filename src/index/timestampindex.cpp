@@ -0,0 +1,131 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/timestampindex.h>
+
+#include <txdb.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <boost/thread.hpp>
+
+constexpr char DB_TIMESTAMPINDEX = 's';
+constexpr char DB_BLOCKHASHINDEX = 'z';
+
+std::unique_ptr<TimestampIndex> g_timestampindex;
+
+/**
+ * Access to the timestamp index database (indexes/timestampindex/)
+ *
+ * Blocks are keyed by big-endian logical timestamp so that a range of time
+ * is a range of keys. The logical timestamp of each block is also kept by
+ * block hash, for the logical timestamp of the next block to build on.
+ */
+class TimestampIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadLogicalTimestamp(const uint256& hash, unsigned int& logicalTS) const;
+
+    bool WriteLogicalTimestamp(const uint256& hash, unsigned int logicalTS);
+
+    bool ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<std::pair<uint256, unsigned int>>& hashes);
+};
+
+TimestampIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "timestampindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool TimestampIndex::DB::ReadLogicalTimestamp(const uint256& hash, unsigned int& logicalTS) const
+{
+    CTimestampBlockIndexValue value;
+    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), value))
+        return false;
+
+    logicalTS = value.ltimestamp;
+    return true;
+}
+
+bool TimestampIndex::DB::WriteLogicalTimestamp(const uint256& hash, unsigned int logicalTS)
+{
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexKey(logicalTS, hash)), 0);
+    batch.Write(std::make_pair(DB_BLOCKHASHINDEX, CTimestampBlockIndexKey(hash)), CTimestampBlockIndexValue(logicalTS));
+    return WriteBatch(batch);
+}
+
+bool TimestampIndex::DB::ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<std::pair<uint256, unsigned int>>& hashes)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CTimestampIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
+            hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+TimestampIndex::TimestampIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<TimestampIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+TimestampIndex::~TimestampIndex() {}
+
+bool TimestampIndex::Init()
+{
+    LOCK(cs_main);
+
+    // Older nodes kept the timestamp index in the block tree database, written
+    // while connecting blocks.
+    if (!m_db->MigrateLegacyData(*pblocktree, "timestampindex", {DB_TIMESTAMPINDEX, DB_BLOCKHASHINDEX}, ::ChainActive().GetLocator())) {
+        return false;
+    }
+
+    return BaseIndex::Init();
+}
+
+bool TimestampIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    unsigned int logicalTS = pindex->nTime;
+    unsigned int prevLogicalTS = 0;
+
+    // retrieve logical timestamp of the previous block
+    if (pindex->pprev && !m_db->ReadLogicalTimestamp(pindex->pprev->GetBlockHash(), prevLogicalTS))
+        LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+
+    if (logicalTS <= prevLogicalTS) {
+        logicalTS = prevLogicalTS + 1;
+        LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+    }
+
+    // Blocks that leave the chain keep their entries, so there is nothing to
+    // undo when the index is rewound
+    return m_db->WriteLogicalTimestamp(pindex->GetBlockHash(), logicalTS);
+}
+
+BaseIndex::DB& TimestampIndex::GetDB() const { return *m_db; }
+
+bool TimestampIndex::FindBlockHashes(unsigned int high, unsigned int low, bool fActiveOnly, std::vector<std::pair<uint256, unsigned int>>& hashes) const
+{
+    std::vector<std::pair<uint256, unsigned int>> vFound;
+    if (!m_db->ReadTimestampIndex(high, low, vFound))
+        return false;
+
+    LOCK(cs_main);
+    for (const std::pair<uint256, unsigned int>& found : vFound) {
+        if (!fActiveOnly || ::ChainActive().Contains(LookupBlockIndex(found.first)))
+            hashes.push_back(found);
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_TIMESTAMPINDEX_H
+#define BITCOIN_INDEX_TIMESTAMPINDEX_H
+
+#include <index/base.h>
+#include <timestampindex.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * TimestampIndex is used to look up blocks by time. Every block gets a logical
+ * timestamp, its time raised past the logical timestamp of its parent so that
+ * logical timestamps increase along a chain. The index is written to a LevelDB
+ * database and records the blocks by logical timestamp.
+ */
+class TimestampIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    /// Override base class init to migrate from the block tree database.
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "timestampindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit TimestampIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~TimestampIndex() override;
+
+    /// Look up the blocks with a logical timestamp in [low, high), in order,
+    /// along with their logical timestamps. Blocks that were disconnected stay
+    /// indexed unless fActiveOnly is set.
+    bool FindBlockHashes(unsigned int high, unsigned int low, bool fActiveOnly, std::vector<std::pair<uint256, unsigned int>>& hashes) const;
+};
+
+/// The global timestamp index, used by getblockhashes. May be null.
+extern std::unique_ptr<TimestampIndex> g_timestampindex;
+
+#endif // BITCOIN_INDEX_TIMESTAMPINDEX_H
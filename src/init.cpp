@@ -21,7 +21,10 @@
 #include <hash.h>
 #include <httprpc.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
 #include <key.h>
@@ -30,6 +33,8 @@
 #include <net_permissions.h>
 #include <net_processing.h>
 #include <netbase.h>
+#include <node/blockindexsnapshot.h>
+#include <node/coinsprefetch.h>
 #include <node/context.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
@@ -165,6 +170,15 @@ void Interrupt(NodeContext& node)
     if (g_txindex) {
         g_txindex->Interrupt();
     }
+    if (g_addressindex) {
+        g_addressindex->Interrupt();
+    }
+    if (g_spentindex) {
+        g_spentindex->Interrupt();
+    }
+    if (g_timestampindex) {
+        g_timestampindex->Interrupt();
+    }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
 }
 
@@ -248,6 +262,18 @@ void Shutdown(NodeContext& node)
         g_txindex->Stop();
         g_txindex.reset();
     }
+    if (g_addressindex) {
+        g_addressindex->Stop();
+        g_addressindex.reset();
+    }
+    if (g_spentindex) {
+        g_spentindex->Stop();
+        g_spentindex.reset();
+    }
+    if (g_timestampindex) {
+        g_timestampindex->Stop();
+        g_timestampindex.reset();
+    }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
 
@@ -261,6 +287,9 @@ void Shutdown(NodeContext& node)
         LOCK(cs_main);
         if (g_chainstate && g_chainstate->CanFlushToDisk()) {
             g_chainstate->ForceFlushStateToDisk();
+            // sumcoin: the block index is complete once a chain tip is loaded
+            if (::ChainActive().Tip() && gArgs.GetBoolArg("-blockindexsnapshot", DEFAULT_BLOCK_INDEX_SNAPSHOT))
+                DumpBlockIndexSnapshot();
             g_chainstate->ResetCoinsViews();
         }
         pblocktree.reset();
@@ -368,6 +397,7 @@ void SetupServerArgs()
     gArgs.AddArg("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockindexsnapshot", strprintf("Write the block index to a snapshot file at shutdown, read at the next start unless the block index changed after it (default: %u)", DEFAULT_BLOCK_INDEX_SNAPSHOT), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #if HAVE_SYSTEM
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -388,6 +418,7 @@ void SetupServerArgs()
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)", -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-prefetchthreads=<n>", strprintf("Set the number of threads reading the coins spent by blocks stored ahead of the chain tip (0-%d, default: %d)", MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -403,6 +434,7 @@ void SetupServerArgs()
         ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
     gArgs.AddArg("-addressindex", strprintf("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)", DEFAULT_ADDRESSINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-addressindexthreads=<n>", strprintf("Set the number of threads reading the address index for queries of several addresses, besides the RPC thread (0-%d, default: %d)", MAX_ADDRESSINDEX_THREADS, DEFAULT_ADDRESSINDEX_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-timestampindex", strprintf("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)", DEFAULT_TIMESTAMPINDEX), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-spentindex", strprintf("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)", DEFAULT_SPENTINDEX), false, OptionsCategory::OPTIONS);
 
@@ -1173,6 +1205,23 @@ bool AppInitMain(NodeContext& node)
         }
     }
 
+    int prefetch_threads = std::max(0, std::min((int)gArgs.GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS), MAX_PREFETCH_THREADS));
+    LogPrintf("Coins of blocks ahead of the tip are read by %d threads\n", prefetch_threads);
+    if (prefetch_threads) {
+        g_coins_prefetcher.SetEnabled(true);
+        for (int i = 0; i < prefetch_threads; ++i) {
+            threadGroup.create_thread([i]() { return ThreadCoinsPrefetch(i); });
+        }
+    }
+
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        int addressindex_threads = std::max(0, std::min((int)gArgs.GetArg("-addressindexthreads", DEFAULT_ADDRESSINDEX_THREADS), MAX_ADDRESSINDEX_THREADS));
+        LogPrintf("Address index lookups use %d additional threads\n", addressindex_threads);
+        for (int i = 0; i < addressindex_threads; ++i) {
+            threadGroup.create_thread([i]() { return ThreadAddressIndexRead(i); });
+        }
+    }
+
     assert(!node.scheduler);
     node.scheduler = MakeUnique<CScheduler>();
 
@@ -1387,17 +1436,27 @@ bool AppInitMain(NodeContext& node)
         filter_index_cache = max_cache / n_indexes;
         nTotalCache -= filter_index_cache * n_indexes;
     }
+    int64_t nAddressIndexCache = 0;
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        nAddressIndexCache = std::min(nTotalCache / 8, nMaxAddressIndexCache << 20);
+        nTotalCache -= nAddressIndexCache;
+    }
+    int64_t nSpentIndexCache = 0;
+    if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        nSpentIndexCache = std::min(nTotalCache / 8, nMaxSpentIndexCache << 20);
+        nTotalCache -= nSpentIndexCache;
+    }
+    int64_t nTimestampIndexCache = 0;
+    if (gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
+        nTimestampIndexCache = std::min(nTotalCache / 8, nMaxBlockDBCache << 20);
+        nTotalCache -= nTimestampIndexCache;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20);                   // cap total coins db cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache;                                                   // the rest goes to in-memory cache
 
-    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
-        // enable 3/4 of the cache if addressindex and/or spentindex is enabled
-        nBlockTreeDBCache = nTotalCache * 3 / 4;
-    } else {
-        nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
-    }
+    nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
 
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     LogPrintf("Cache configuration:\n");
@@ -1407,6 +1466,15 @@ bool AppInitMain(NodeContext& node)
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
             filter_index_cache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
     }
+    if (nAddressIndexCache > 0) {
+        LogPrintf("* Using %.1f MiB for address index database\n", nAddressIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (nSpentIndexCache > 0) {
+        LogPrintf("* Using %.1f MiB for spent index database\n", nSpentIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (nTimestampIndexCache > 0) {
+        LogPrintf("* Using %.1f MiB for timestamp index database\n", nTimestampIndexCache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1451,25 +1519,6 @@ bool AppInitMain(NodeContext& node)
                     return InitError(_("Incorrect or no genesis block found. Wrong datadir for network?").translated);
                 }
 
-
-                // Check for changed -addressindex state
-                if (fAddressIndex != gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -addressindex").translated;
-                    break;
-                }
-
-                // Check for changed -spentindex state
-                if (fSpentIndex != gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -spentindex").translated;
-                    break;
-                }
-
-                // Check for changed -timestampindex state
-                if (fTimestampIndex != gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -timestampindex").translated;
-                    break;
-                }
-
                 // At this point blocktree args are consistent with what's on disk.
                 // If we're not mid-reindex (based on disk + args), add a genesis block on disk
                 // (otherwise we use the one already on disk).
@@ -1605,6 +1654,28 @@ bool AppInitMain(NodeContext& node)
         GetBlockFilterIndex(filter_type)->Start();
     }
 
+    // The address, spent and timestamp indexes sync in the background like the
+    // txindex, so they can be turned on or off across restarts. What older
+    // nodes kept of an index that is off is stale from now on.
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        g_addressindex = MakeUnique<AddressIndex>(nAddressIndexCache, false, fReindex);
+        g_addressindex->Start();
+    } else {
+        pblocktree->WriteFlag("addressindex", false);
+    }
+    if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        g_spentindex = MakeUnique<SpentIndex>(nSpentIndexCache, false, fReindex);
+        g_spentindex->Start();
+    } else {
+        pblocktree->WriteFlag("spentindex", false);
+    }
+    if (gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
+        g_timestampindex = MakeUnique<TimestampIndex>(nTimestampIndexCache, false, fReindex);
+        g_timestampindex->Start();
+    } else {
+        pblocktree->WriteFlag("timestampindex", false);
+    }
+
     // ********************************************************* Step 9: load wallet
     for (const auto& client : node.chain_clients) {
         if (!client->load()) {
@@ -278,6 +278,18 @@ public:
         }
         return result;
     }
+    std::vector<KernelRecord> getMintingRecords() override
+    {
+        auto locked_chain = m_wallet->chain().lock();
+        LOCK(m_wallet->cs_wallet);
+        return m_wallet->GetMintingTable().GetRecords();
+    }
+    std::vector<KernelRecord> getMintingRecords(const uint256& txid) override
+    {
+        auto locked_chain = m_wallet->chain().lock();
+        LOCK(m_wallet->cs_wallet);
+        return m_wallet->GetMintingTable().GetRecords(txid);
+    }
     bool tryGetTxStatus(const uint256& txid,
         interfaces::WalletTxStatus& tx_status,
         int& num_blocks,
@@ -26,6 +26,7 @@ class CCoinControl;
 class CFeeRate;
 class CKey;
 class CWallet;
+class KernelRecord;
 enum isminetype : unsigned int;
 enum class FeeReason;
 typedef uint8_t isminefilter;
@@ -158,6 +159,10 @@ public:
     //! Get list of all wallet transactions.
     virtual std::vector<WalletTx> getWalletTxs() = 0;
 
+    //! Get outputs that may mint, of the whole wallet or of one transaction.
+    virtual std::vector<KernelRecord> getMintingRecords() = 0;
+    virtual std::vector<KernelRecord> getMintingRecords(const uint256& txid) = 0;
+
     //! Try to get updated status for a particular transaction, if possible without blocking.
     virtual bool tryGetTxStatus(const uint256& txid,
         WalletTxStatus& tx_status,
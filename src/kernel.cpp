@@ -3,11 +3,15 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <kernel.h>
+#include <kernelprevout.h>
 #include <chainparams.h>
 #include <validation.h>
 #include <streams.h>
 #include <timedata.h>
-#include <bignum.h>
+#include <arith_uint256.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <hash.h>
 #include <txdb.h>
 #include <consensus/validation.h>
 #include <random.h>
@@ -15,6 +19,9 @@
 
 #include <index/txindex.h>
 
+#include <algorithm>
+#include <atomic>
+
 #include <boost/assign/list_of.hpp>
 
 using namespace std;
@@ -155,69 +162,85 @@ static bool GetLastStakeModifier(const CBlockIndex* pindex, uint64_t& nStakeModi
     return true;
 }
 
-// Get selection interval section (in seconds)
-static int64_t GetStakeModifierSelectionIntervalSection(int nSection)
+// Stake modifier selection interval sections (in seconds) and their total,
+// which only depend on the modifier interval of the chain parameters
+struct StakeModifierSelectionIntervals {
+    int64_t nModifierInterval{0};
+    int64_t nSection[64];
+    int64_t nTotal{0};
+};
+
+static StakeModifierSelectionIntervals g_stake_modifier_selection_intervals GUARDED_BY(cs_main);
+
+// Get the selection interval sections, computed again only when the modifier
+// interval changes
+static const StakeModifierSelectionIntervals& GetStakeModifierSelectionIntervals() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
-    assert (nSection >= 0 && nSection < 64);
-    return (Params().GetConsensus().nModifierInterval * 63 / (63 + ((63 - nSection) * (MODIFIER_INTERVAL_RATIO - 1))));
+    StakeModifierSelectionIntervals& intervals = g_stake_modifier_selection_intervals;
+    const int64_t nModifierInterval = Params().GetConsensus().nModifierInterval;
+    if (intervals.nModifierInterval != nModifierInterval) {
+        intervals.nModifierInterval = nModifierInterval;
+        intervals.nTotal = 0;
+        for (int nSection = 0; nSection < 64; nSection++) {
+            intervals.nSection[nSection] = nModifierInterval * 63 / (63 + ((63 - nSection) * (MODIFIER_INTERVAL_RATIO - 1)));
+            intervals.nTotal += intervals.nSection[nSection];
+        }
+    }
+    return intervals;
 }
 
 // Get stake modifier selection interval (in seconds)
-static int64_t GetStakeModifierSelectionInterval()
+static int64_t GetStakeModifierSelectionInterval() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
-    int64_t nSelectionInterval = 0;
-    for (int nSection=0; nSection<64; nSection++)
-        nSelectionInterval += GetStakeModifierSelectionIntervalSection(nSection);
-    return nSelectionInterval;
+    return GetStakeModifierSelectionIntervals().nTotal;
 }
 
-// select a block from the candidate blocks in vSortedByTimestamp, excluding
-// already selected blocks in vSelectedBlocks, and with timestamp up to
+// A block of the stake modifier selection window
+struct StakeModifierCandidate {
+    const CBlockIndex* pindex;
+    arith_uint256 hashSelection;
+    bool fSelected;
+};
+
+// Compute the selection hash of a candidate block by hashing its proof-hash
+// and the previous proof-of-stake modifier
+static arith_uint256 GetStakeModifierSelectionHash(const CBlockIndex* pindex, uint64_t nStakeModifierPrev)
+{
+    const uint256& hashProof = pindex->IsProofOfStake() ? pindex->hashProofOfStake : *pindex->phashBlock;
+    unsigned char vchModifierPrev[8];
+    WriteLE64(vchModifierPrev, nStakeModifierPrev);
+    uint256 hashSelection;
+    CHash256().Write(hashProof.begin(), hashProof.size()).Write(vchModifierPrev, sizeof(vchModifierPrev)).Finalize(hashSelection.begin());
+    arith_uint256 bnSelection = UintToArith256(hashSelection);
+    // the selection hash is divided by 2**32 so that proof-of-stake block
+    // is always favored over proof-of-work block. this is to preserve
+    // the energy efficiency property
+    if (pindex->IsProofOfStake())
+        bnSelection >>= 32;
+    return bnSelection;
+}
+
+// select a block from the candidate blocks in vCandidates, sorted by
+// timestamp, excluding already selected blocks, and with timestamp up to
 // nSelectionIntervalStop.
-static bool SelectBlockFromCandidates(
-    vector<pair<int64_t, uint256> >& vSortedByTimestamp,
-    map<uint256, const CBlockIndex*>& mapSelectedBlocks,
-    int64_t nSelectionIntervalStop, uint64_t nStakeModifierPrev,
-    const CBlockIndex** pindexSelected)
-{
-    bool fSelected = false;
-    arith_uint256 hashBest = 0;
-    *pindexSelected = (const CBlockIndex*) 0;
-    for (const auto& item : vSortedByTimestamp)
+static const CBlockIndex* SelectBlockFromCandidates(std::vector<StakeModifierCandidate>& vCandidates, int64_t nSelectionIntervalStop, bool fPrintStakeModifier)
+{
+    StakeModifierCandidate* pbest = nullptr;
+    for (StakeModifierCandidate& candidate : vCandidates)
     {
-        if (!::BlockIndex().count(item.second))
-            return error("SelectBlockFromCandidates: failed to find block index for candidate block %s", item.second.ToString());
-        const CBlockIndex* pindex = ::BlockIndex()[item.second];
-        if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop)
+        if (pbest && candidate.pindex->GetBlockTime() > nSelectionIntervalStop)
             break;
-        if (mapSelectedBlocks.count(pindex->GetBlockHash()) > 0)
+        if (candidate.fSelected)
             continue;
-        // compute the selection hash by hashing its proof-hash and the
-        // previous proof-of-stake modifier
-        uint256 hashProof = pindex->IsProofOfStake()? pindex->hashProofOfStake : pindex->GetBlockHash();
-        CDataStream ss(SER_GETHASH, 0);
-        ss << hashProof << nStakeModifierPrev;
-        arith_uint256 hashSelection = UintToArith256(Hash(ss.begin(), ss.end()));
-        // the selection hash is divided by 2**32 so that proof-of-stake block
-        // is always favored over proof-of-work block. this is to preserve
-        // the energy efficiency property
-        if (pindex->IsProofOfStake())
-            hashSelection >>= 32;
-        if (fSelected && hashSelection < hashBest)
-        {
-            hashBest = hashSelection;
-            *pindexSelected = (const CBlockIndex*) pindex;
-        }
-        else if (!fSelected)
-        {
-            fSelected = true;
-            hashBest = hashSelection;
-            *pindexSelected = (const CBlockIndex*) pindex;
-        }
+        if (!pbest || candidate.hashSelection < pbest->hashSelection)
+            pbest = &candidate;
     }
-    if (gArgs.GetBoolArg("-debug", false) && gArgs.GetBoolArg("-printstakemodifier", false))
-        LogPrintf("SelectBlockFromCandidates: selection hash=%s\n", hashBest.ToString());
-    return fSelected;
+    if (!pbest)
+        return nullptr;
+    if (fPrintStakeModifier)
+        LogPrintf("SelectBlockFromCandidates: selection hash=%s\n", pbest->hashSelection.ToString());
+    pbest->fSelected = true;
+    return pbest->pindex;
 }
 
 // Stake Modifier (hash modifier of proof-of-stake):
@@ -235,7 +258,9 @@ static bool SelectBlockFromCandidates(
 // blocks.
 bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t &nStakeModifier, bool& fGeneratedStakeModifier)
 {
+    AssertLockHeld(cs_main);
     const Consensus::Params& params = Params().GetConsensus();
+    const bool fPrintStakeModifier = gArgs.GetBoolArg("-debug", false) && gArgs.GetBoolArg("-printstakemodifier", false);
     const CBlockIndex* pindexPrev = pindexCurrent->pprev;
     nStakeModifier = 0;
     fGeneratedStakeModifier = false;
@@ -273,30 +298,27 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t &nStake
         }
     }
 
-    // Sort candidate blocks by timestamp
-    vector<pair<int64_t, uint256> > vSortedByTimestamp;
-    vSortedByTimestamp.reserve(64 * params.nModifierInterval / params.nStakeTargetSpacing);
-    int64_t nSelectionInterval = GetStakeModifierSelectionInterval();
-    int64_t nSelectionIntervalStart = (pindexPrev->GetBlockTime() / params.nModifierInterval) * params.nModifierInterval - nSelectionInterval;
+    // Sort candidate blocks by timestamp. The selection hash of a candidate
+    // is the same in every round, so it is computed once.
+    const StakeModifierSelectionIntervals& intervals = GetStakeModifierSelectionIntervals();
+    std::vector<StakeModifierCandidate> vCandidates;
+    vCandidates.reserve(64 * params.nModifierInterval / params.nStakeTargetSpacing);
+    int64_t nSelectionIntervalStart = (pindexPrev->GetBlockTime() / params.nModifierInterval) * params.nModifierInterval - intervals.nTotal;
     const CBlockIndex* pindex = pindexPrev;
     while (pindex && pindex->GetBlockTime() >= nSelectionIntervalStart)
     {
-        vSortedByTimestamp.push_back(make_pair(pindex->GetBlockTime(), pindex->GetBlockHash()));
+        vCandidates.push_back({pindex, GetStakeModifierSelectionHash(pindex, nStakeModifier), false});
         pindex = pindex->pprev;
     }
     int nHeightFirstCandidate = pindex ? (pindex->nHeight + 1) : 0;
 
-    // Shuffle before sort
-    for(int i = vSortedByTimestamp.size() - 1; i > 1; --i)
-    std::swap(vSortedByTimestamp[i], vSortedByTimestamp[GetRand(i)]);
-
-    sort(vSortedByTimestamp.begin(), vSortedByTimestamp.end(), [] (const pair<int64_t, uint256> &a, const pair<int64_t, uint256> &b)
+    std::sort(vCandidates.begin(), vCandidates.end(), [] (const StakeModifierCandidate& a, const StakeModifierCandidate& b)
     {
-        if (a.first != b.first)
-            return a.first < b.first;
+        if (a.pindex->GetBlockTime() != b.pindex->GetBlockTime())
+            return a.pindex->GetBlockTime() < b.pindex->GetBlockTime();
         // Timestamp equals - compare block hashes
-        const uint32_t *pa = a.second.GetDataPtr();
-        const uint32_t *pb = b.second.GetDataPtr();
+        const uint32_t *pa = a.pindex->phashBlock->GetDataPtr();
+        const uint32_t *pb = b.pindex->phashBlock->GetDataPtr();
         int cnt = 256 / 32;
         do {
             --cnt;
@@ -309,25 +331,26 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t &nStake
     // Select 64 blocks from candidate blocks to generate stake modifier
     uint64_t nStakeModifierNew = 0;
     int64_t nSelectionIntervalStop = nSelectionIntervalStart;
-    map<uint256, const CBlockIndex*> mapSelectedBlocks;
-    for (int nRound=0; nRound<min(64, (int)vSortedByTimestamp.size()); nRound++)
+    std::vector<const CBlockIndex*> vSelectedBlocks;
+    for (int nRound=0; nRound<min(64, (int)vCandidates.size()); nRound++)
     {
         // add an interval section to the current selection round
-        nSelectionIntervalStop += GetStakeModifierSelectionIntervalSection(nRound);
+        nSelectionIntervalStop += intervals.nSection[nRound];
         // select a block from the candidates of current round
-        if (!SelectBlockFromCandidates(vSortedByTimestamp, mapSelectedBlocks, nSelectionIntervalStop, nStakeModifier, &pindex))
+        pindex = SelectBlockFromCandidates(vCandidates, nSelectionIntervalStop, fPrintStakeModifier);
+        if (!pindex)
             return error("ComputeNextStakeModifier: unable to select block at round %d", nRound);
         // write the entropy bit of the selected block
         nStakeModifierNew |= (((uint64_t)pindex->GetStakeEntropyBit()) << nRound);
         // add the selected block from candidates to selected list
-        mapSelectedBlocks.insert(make_pair(pindex->GetBlockHash(), pindex));
-        if (gArgs.GetBoolArg("-debug", false) && gArgs.GetBoolArg("-printstakemodifier", false))
+        vSelectedBlocks.push_back(pindex);
+        if (fPrintStakeModifier)
             LogPrintf("ComputeNextStakeModifier: selected round %d stop=%s height=%d bit=%d\n",
                 nRound, FormatISO8601DateTime(nSelectionIntervalStop), pindex->nHeight, pindex->GetStakeEntropyBit());
     }
 
     // Print selection map for visualization of the selected blocks
-    if (gArgs.GetBoolArg("-debug", false) && gArgs.GetBoolArg("-printstakemodifier", false))
+    if (fPrintStakeModifier)
     {
         string strSelectionMap = "";
         // '-' indicates proof-of-work blocks not selected
@@ -340,11 +363,11 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t &nStake
                 strSelectionMap.replace(pindex->nHeight - nHeightFirstCandidate, 1, "=");
             pindex = pindex->pprev;
         }
-        for (const auto& item : mapSelectedBlocks)
+        for (const CBlockIndex* pindexSelected : vSelectedBlocks)
         {
             // 'S' indicates selected proof-of-stake blocks
             // 'W' indicates selected proof-of-work blocks
-            strSelectionMap.replace(item.second->nHeight - nHeightFirstCandidate, 1, item.second->IsProofOfStake()? "S" : "W");
+            strSelectionMap.replace(pindexSelected->nHeight - nHeightFirstCandidate, 1, pindexSelected->IsProofOfStake()? "S" : "W");
         }
         LogPrintf("ComputeNextStakeModifier: selection height [%d, %d] map %s\n", nHeightFirstCandidate, pindexPrev->nHeight, strSelectionMap);
     }
@@ -356,11 +379,147 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t &nStake
     return true;
 }
 
+// Catch up with the chain, dropping the generations of blocks it no longer
+// contains and appending those of the blocks added since the last use
+void CStakeModifierTimeline::Sync(const CChain& chain)
+{
+    if (m_nHeight > chain.Height() || (m_nHeight >= 0 && chain[m_nHeight]->GetBlockHash() != m_hashTip)) {
+        // A block hash commits to its ancestors, so the entries below the
+        // last one still on the chain are on it too
+        while (!m_entries.empty() && (m_entries.back().nHeight > chain.Height() || chain[m_entries.back().nHeight]->GetBlockHash() != m_entries.back().hashBlock))
+            m_entries.pop_back();
+        m_nHeight = m_entries.empty() ? -1 : m_entries.back().nHeight;
+    }
+    for (int nHeight = m_nHeight + 1; nHeight <= chain.Height(); nHeight++) {
+        if (chain[nHeight]->GeneratedStakeModifier())
+            Append(chain[nHeight]);
+    }
+    m_nHeight = chain.Height();
+    m_hashTip = chain.Tip() ? chain.Tip()->GetBlockHash() : uint256();
+}
+
+static CStakeModifierTimeline::Entry MakeTimelineEntry(const CBlockIndex* pindex)
+{
+    CStakeModifierTimeline::Entry entry;
+    entry.nTime = pindex->GetBlockTime();
+    entry.nStakeModifier = pindex->nStakeModifier;
+    entry.nHeight = pindex->nHeight;
+    entry.hashBlock = pindex->GetBlockHash();
+    entry.nTimeMax = entry.nTime;
+    entry.nDescent = 0;
+    return entry;
+}
+
+void CStakeModifierTimeline::Append(const CBlockIndex* pindex)
+{
+    Entry entry = MakeTimelineEntry(pindex);
+    if (!m_entries.empty()) {
+        const Entry& last = m_entries.back();
+        entry.nTimeMax = std::max(entry.nTime, last.nTimeMax);
+        entry.nDescent = entry.nTime < last.nTime ? m_entries.size() : last.nDescent;
+    }
+    m_entries.push_back(entry);
+}
+
+size_t CStakeModifierTimeline::UpperBound(int nHeight) const
+{
+    return std::upper_bound(m_entries.begin(), m_entries.end(), nHeight, [](int nHeight, const Entry& entry) {
+        return nHeight < entry.nHeight;
+    }) - m_entries.begin();
+}
+
+bool CStakeModifierTimeline::FindLatestAtOrBefore(const CChain& chain, const CBlockIndex* pindexPrev, int64_t nTimeMax, Entry& entry)
+{
+    Sync(chain);
+
+    // Generations on a side branch, from its tip down to the fork point
+    const CBlockIndex* pindex = pindexPrev->pprev;
+    while (pindex && !chain.Contains(pindex)) {
+        if (pindex->GeneratedStakeModifier() && pindex->GetBlockTime() <= nTimeMax) {
+            entry = MakeTimelineEntry(pindex);
+            return true;
+        }
+        pindex = pindex->pprev;
+    }
+    if (!pindex)
+        return false;
+
+    // Latest of the entries up to the fork point timed at most nTimeMax. The
+    // entries from the first one past nTimeMax on are all later than it,
+    // unless generation times go back somewhere in between.
+    const size_t nEnd = UpperBound(pindex->nHeight);
+    const size_t nFirstLater = std::upper_bound(m_entries.begin(), m_entries.begin() + nEnd, nTimeMax, [](int64_t nTime, const Entry& e) {
+        return nTime < e.nTimeMax;
+    }) - m_entries.begin();
+    if (nFirstLater < nEnd && m_entries[nEnd - 1].nDescent > nFirstLater) {
+        for (size_t i = nEnd; i-- > nFirstLater;) {
+            if (m_entries[i].nTime <= nTimeMax) {
+                entry = m_entries[i];
+                return true;
+            }
+        }
+    }
+    if (nFirstLater == 0)
+        return false;
+    entry = m_entries[nFirstLater - 1];
+    return true;
+}
+
+bool CStakeModifierTimeline::FindFirstAtOrAfter(const CChain& chain, const CBlockIndex* pindexFrom, const CBlockIndex* pindexLast, int64_t nTimeMin, Entry& entry)
+{
+    Sync(chain);
+
+    // Generations on a side branch above pindexFrom, from its tip down
+    std::vector<const CBlockIndex*> vBranch;
+    const CBlockIndex* pindex = pindexLast;
+    while (pindex && pindex->nHeight > pindexFrom->nHeight && !chain.Contains(pindex)) {
+        if (pindex->GeneratedStakeModifier())
+            vBranch.push_back(pindex);
+        pindex = pindex->pprev;
+    }
+
+    // First of the entries above pindexFrom up to the fork point timed at
+    // least nTimeMin. It is the first one whose latest generation time so far
+    // reaches nTimeMin, unless an entry before pindexFrom already does.
+    if (pindex && pindex->nHeight > pindexFrom->nHeight) {
+        const size_t nBegin = UpperBound(pindexFrom->nHeight);
+        const size_t nEnd = UpperBound(pindex->nHeight);
+        if (nBegin > 0 && m_entries[nBegin - 1].nTimeMax >= nTimeMin) {
+            for (size_t i = nBegin; i < nEnd; i++) {
+                if (m_entries[i].nTime >= nTimeMin) {
+                    entry = m_entries[i];
+                    return true;
+                }
+            }
+        } else {
+            const size_t i = std::lower_bound(m_entries.begin() + nBegin, m_entries.begin() + nEnd, nTimeMin, [](const Entry& e, int64_t nTime) {
+                return e.nTimeMax < nTime;
+            }) - m_entries.begin();
+            if (i < nEnd) {
+                entry = m_entries[i];
+                return true;
+            }
+        }
+    }
+
+    for (auto it = vBranch.rbegin(); it != vBranch.rend(); ++it) {
+        if ((*it)->GetBlockTime() >= nTimeMin) {
+            entry = MakeTimelineEntry(*it);
+            return true;
+        }
+    }
+    return false;
+}
+
+// The timeline of the active chain
+static CStakeModifierTimeline g_stake_modifier_timeline GUARDED_BY(cs_main);
+
 // V0.5: Stake modifier used to hash for a stake kernel is chosen as the stake
 // modifier that is (nStakeMinAge minus a selection interval) earlier than the
 // stake, thus at least a selection interval later than the coin generating the // kernel, as the generating coin is from at least nStakeMinAge ago.
 static bool GetKernelStakeModifierV05(CBlockIndex* pindexPrev, unsigned int nTimeTx, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake)
 {
+    AssertLockHeld(cs_main);
     const Consensus::Params& params = Params().GetConsensus();
     const CBlockIndex* pindex = pindexPrev;
     nStakeModifierHeight = pindex->nHeight;
@@ -377,22 +536,16 @@ static bool GetKernelStakeModifierV05(CBlockIndex* pindexPrev, unsigned int nTim
         else
             return false;
     }
-    // loop to find the stake modifier earlier by 
+    // find the stake modifier earlier by
     // (nStakeMinAge minus a selection interval)
-    while (nStakeModifierTime + params.nStakeMinAge - nStakeModifierSelectionInterval >(int64_t) nTimeTx)
-    {
-        if (!pindex->pprev)
-        {   // reached genesis block; should not happen
-            return error("GetKernelStakeModifier() : reached genesis block");
-        }
-        pindex = pindex->pprev;
-        if (pindex->GeneratedStakeModifier())
-        {
-            nStakeModifierHeight = pindex->nHeight;
-            nStakeModifierTime = pindex->GetBlockTime();
-        }
+    CStakeModifierTimeline::Entry entry;
+    if (!g_stake_modifier_timeline.FindLatestAtOrBefore(::ChainActive(), pindexPrev, (int64_t)nTimeTx - params.nStakeMinAge + nStakeModifierSelectionInterval, entry))
+    {   // reached genesis block; should not happen
+        return error("GetKernelStakeModifier() : reached genesis block");
     }
-    nStakeModifier = pindex->nStakeModifier;
+    nStakeModifier = entry.nStakeModifier;
+    nStakeModifierHeight = entry.nHeight;
+    nStakeModifierTime = entry.nTime;
     return true;
 }
 
@@ -400,6 +553,7 @@ static bool GetKernelStakeModifierV05(CBlockIndex* pindexPrev, unsigned int nTim
 // modifier about a selection interval later than the coin generating the kernel
 static bool GetKernelStakeModifierV03(CBlockIndex* pindexPrev, uint256 hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake)
 {
+    AssertLockHeld(cs_main);
     const Consensus::Params& params = Params().GetConsensus();
     nStakeModifier = 0;
     if (!::BlockIndex().count(hashBlockFrom))
@@ -409,7 +563,28 @@ static bool GetKernelStakeModifierV03(CBlockIndex* pindexPrev, uint256 hashBlock
     nStakeModifierTime = pindexFrom->GetBlockTime();
     int64_t nStakeModifierSelectionInterval = GetStakeModifierSelectionInterval();
 
+    // The walk below goes on along the active chain past pindexPrev when that
+    // is on it, and otherwise ends at pindexPrev
+    const CBlockIndex* pindexLast = ::ChainActive().Contains(pindexPrev) ? ::ChainActive().Tip() : pindexPrev;
+    if (pindexLast->GetAncestor(pindexFrom->nHeight) == pindexFrom)
+    {
+        // find the stake modifier later by a selection interval
+        CStakeModifierTimeline::Entry entry;
+        if (!g_stake_modifier_timeline.FindFirstAtOrAfter(::ChainActive(), pindexFrom, pindexLast, pindexFrom->GetBlockTime() + nStakeModifierSelectionInterval, entry))
+        {   // reached best block; may happen if node is behind on block chain
+            if (fPrintProofOfStake || (pindexLast->GetBlockTime() + params.nStakeMinAge - nStakeModifierSelectionInterval > GetAdjustedTime()))
+                return error("GetKernelStakeModifier() : reached best block %s at height %d from block %s",
+                    pindexLast->GetBlockHash().ToString(), pindexLast->nHeight, hashBlockFrom.ToString());
+            else
+                return false;
+        }
+        nStakeModifier = entry.nStakeModifier;
+        nStakeModifierHeight = entry.nHeight;
+        nStakeModifierTime = entry.nTime;
+        return true;
+    }
 
+    // The coin is not on the chain of pindexPrev, walk the blocks as before.
     // we need to iterate index forward but we cannot depend on chainActive.Next()
     // because there is no guarantee that we are checking blocks in active chain.
     // So, we construct a temporary chain that we will iterate over.
@@ -459,6 +634,45 @@ static bool GetKernelStakeModifier(CBlockIndex* pindexPrev, uint256 hashBlockFro
         return GetKernelStakeModifierV03(pindexPrev, hashBlockFrom, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake);
 }
 
+// Check hashProofOfStake <= bnTargetPerCoinDay * nCoinDayWeight with
+// fixed-width integers. The result is bit-exact with the signed arbitrary
+// precision computation of the original protocol:
+//     nCoinDayWeight = nValueIn * nTimeWeight / COIN / (24 * 60 * 60)
+// where divisions truncate toward zero and nBits may decode to a negative
+// or out of range target. The product can exceed 256 bits, so it is
+// compared in 512 bits.
+// Magnitude of the coin-day weight of a stake: floor(nValue * nWeight / COIN / (24 * 60 * 60))
+static arith_uint256 GetCoinDayWeight(uint64_t nValue, uint64_t nWeight)
+{
+    if (nValue / COIN <= std::numeric_limits<uint32_t>::max() && nWeight <= std::numeric_limits<uint32_t>::max()) {
+        // Split the value at COIN so that every step fits in 64 bits:
+        // floor((q * COIN + r) * w / COIN) == q * w + floor(r * w / COIN)
+        const uint64_t nCoinSeconds = (nValue / COIN) * nWeight + (nValue % COIN) * nWeight / COIN;
+        return arith_uint256(nCoinSeconds / (24 * 60 * 60));
+    }
+    return arith_uint256(nValue) * arith_uint256(nWeight) / arith_uint256(COIN * 24 * 60 * 60);
+}
+
+bool CheckStakeKernelTarget(unsigned int nBits, int64_t nValueIn, int64_t nTimeWeight, const uint256& hashProofOfStake)
+{
+    bool fNegative;
+    bool fOverflow;
+    arith_uint256 bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(nBits, &fNegative, &fOverflow);
+
+    const uint64_t nValue = nValueIn < 0 ? -(uint64_t)nValueIn : nValueIn;
+    const uint64_t nWeight = nTimeWeight < 0 ? -(uint64_t)nTimeWeight : nTimeWeight;
+    const arith_uint256 bnCoinDayWeight = GetCoinDayWeight(nValue, nWeight);
+
+    if (bnCoinDayWeight == 0 || (bnTargetPerCoinDay == 0 && !fOverflow))
+        return hashProofOfStake.IsNull();
+    if (fNegative != ((nValueIn < 0) != (nTimeWeight < 0)))
+        return false;
+    if (fOverflow) // target alone is at least 2^256
+        return true;
+    return arith_uint512(UintToArith256(hashProofOfStake)) <= arith_uint512(bnCoinDayWeight) * arith_uint512(bnTargetPerCoinDay);
+}
+
 // sumcoin kernel protocol
 // coinstake must meet hash target according to the protocol:
 // kernel (input 0) must meet the formula
@@ -485,25 +699,23 @@ static bool GetKernelStakeModifier(CBlockIndex* pindexPrev, uint256 hashBlockFro
 //   quantities so as to generate blocks faster, degrading the system back into
 //   a proof-of-work situation.
 //
-bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBlockHeader& blockFrom, unsigned int nTxPrevOffset, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake)
+bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CKernelPrevout& kernel, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake)
 {
     const Consensus::Params& params = Params().GetConsensus();
-    unsigned int nTimeBlockFrom = blockFrom.GetBlockTime();
+    unsigned int nTimeBlockFrom = kernel.nTimeBlock;
+    unsigned int nTimeTxPrev = kernel.GetTxTime();
 
-    if (nTimeTx < (txPrev->nTime? txPrev->nTime : nTimeBlockFrom))  // Transaction timestamp violation
+    if (nTimeTx < nTimeTxPrev)  // Transaction timestamp violation
         return error("CheckStakeKernelHash() : nTime violation");
 
     if (nTimeBlockFrom + params.nStakeMinAge > nTimeTx) // Min age requirement
         return error("CheckStakeKernelHash() : min age violation");
 
-    CBigNum bnTargetPerCoinDay;
-    bnTargetPerCoinDay.SetCompact(nBits);
-    int64_t nValueIn = txPrev->vout[prevout.n].nValue;
+    int64_t nValueIn = kernel.txout.nValue;
     // v0.3 protocol kernel hash weight starts from 0 at the 30-day min age
     // this change increases active coins participating the hash and helps
     // to secure the network when proof-of-stake difficulty is low
-    int64_t nTimeWeight = min((int64_t)nTimeTx - (txPrev->nTime? txPrev->nTime : nTimeBlockFrom), params.nStakeMaxAge) - (IsProtocolV03(nTimeTx)? params.nStakeMinAge : 0);
-    CBigNum bnCoinDayWeight = CBigNum(nValueIn) * nTimeWeight / COIN / (24 * 60 * 60);
+    int64_t nTimeWeight = min((int64_t)nTimeTx - nTimeTxPrev, params.nStakeMaxAge) - (IsProtocolV03(nTimeTx)? params.nStakeMinAge : 0);
     // Calculate hash
     CDataStream ss(SER_GETHASH, 0);
     uint64_t nStakeModifier = 0;
@@ -511,7 +723,7 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
     int64_t nStakeModifierTime = 0;
     if (IsProtocolV03(nTimeTx))  // v0.3 protocol
     {
-        if (!GetKernelStakeModifier(pindexPrev, blockFrom.GetHash(), nTimeTx, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake))
+        if (!GetKernelStakeModifier(pindexPrev, kernel.hashBlock, nTimeTx, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake))
             return false;
         ss << nStakeModifier;
     }
@@ -520,7 +732,7 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
         ss << nBits;
     }
 
-    ss << nTimeBlockFrom << nTxPrevOffset << (txPrev->nTime? txPrev->nTime : nTimeBlockFrom) << prevout.n << nTimeTx;
+    ss << nTimeBlockFrom << kernel.nTxOffset << nTimeTxPrev << prevout.n << nTimeTx;
     hashProofOfStake = Hash(ss.begin(), ss.end());
     if (fPrintProofOfStake)
     {
@@ -528,17 +740,17 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
             LogPrintf("CheckStakeKernelHash() : using modifier 0x%016x at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
                 nStakeModifier, nStakeModifierHeight,
                 FormatISO8601DateTime(nStakeModifierTime),
-                ::BlockIndex()[blockFrom.GetHash()]->nHeight,
-                FormatISO8601DateTime(blockFrom.GetBlockTime()));
+                ::BlockIndex()[kernel.hashBlock]->nHeight,
+                FormatISO8601DateTime(nTimeBlockFrom));
         LogPrintf("CheckStakeKernelHash() : check protocol=%s modifier=0x%016x nTimeBlockFrom=%u nTxPrevOffset=%u nTimeTxPrev=%u nPrevout=%u nTimeTx=%u hashProof=%s\n",
             IsProtocolV05(nTimeTx)? "0.5" : (IsProtocolV03(nTimeTx)? "0.3" : "0.2"),
             IsProtocolV03(nTimeTx)? nStakeModifier : (uint64_t) nBits,
-            nTimeBlockFrom, nTxPrevOffset, (txPrev->nTime? txPrev->nTime : nTimeBlockFrom), prevout.n, nTimeTx,
+            nTimeBlockFrom, kernel.nTxOffset, nTimeTxPrev, prevout.n, nTimeTx,
             hashProofOfStake.ToString());
     }
 
     // Now check if proof-of-stake hash meets target protocol
-    if (CBigNum(hashProofOfStake) > bnCoinDayWeight * bnTargetPerCoinDay)
+    if (!CheckStakeKernelTarget(nBits, nValueIn, nTimeWeight, hashProofOfStake))
         return false;
     if (gArgs.GetBoolArg("-debug", false) && !fPrintProofOfStake)
     {
@@ -546,62 +758,268 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
             LogPrintf("CheckStakeKernelHash() : using modifier 0x%016x at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
                 nStakeModifier, nStakeModifierHeight, 
                 FormatISO8601DateTime(nStakeModifierTime),
-                ::BlockIndex()[blockFrom.GetHash()]->nHeight,
-                FormatISO8601DateTime(blockFrom.GetBlockTime()));
+                ::BlockIndex()[kernel.hashBlock]->nHeight,
+                FormatISO8601DateTime(nTimeBlockFrom));
         LogPrintf("CheckStakeKernelHash() : pass protocol=%s modifier=0x%016x nTimeBlockFrom=%u nTxPrevOffset=%u nTimeTxPrev=%u nPrevout=%u nTimeTx=%u hashProof=%s\n",
             IsProtocolV03(nTimeTx)? "0.3" : "0.2",
             IsProtocolV03(nTimeTx)? nStakeModifier : (uint64_t) nBits,
-            nTimeBlockFrom, nTxPrevOffset, (txPrev->nTime? txPrev->nTime : nTimeBlockFrom), prevout.n, nTimeTx,
+            nTimeBlockFrom, kernel.nTxOffset, nTimeTxPrev, prevout.n, nTimeTx,
             hashProofOfStake.ToString());
     }
     return true;
 }
 
-// Check kernel hash target and coinstake signature
-bool CheckProofOfStake(BlockValidationState &state, CBlockIndex* pindexPrev, const CTransactionRef& tx, unsigned int nBits, uint256& hashProofOfStake, unsigned int nTimeTx)
+// Prepare a batched kernel search. Requires cs_main for the stake modifiers.
+// Returns false if no candidate can be checked at any timestamp of the window.
+bool CStakeKernelSearch::Prepare(unsigned int nBits, CBlockIndex* pindexPrev, unsigned int nTimeTx, unsigned int nSearchInterval, std::vector<CStakeCandidate> vCandidates)
 {
-    if (!tx->IsCoinStake())
-        return error("CheckProofOfStake() : called on non-coinstake %s", tx->GetHash().ToString());
+    AssertLockHeld(cs_main);
+    const Consensus::Params& params = Params().GetConsensus();
+    m_nBits = nBits;
+    m_nStakeMinAge = params.nStakeMinAge;
+    m_nStakeMaxAge = params.nStakeMaxAge;
+    m_timestamps.clear();
+    m_candidates.clear();
 
-    // Kernel (input 0) must match the stake hash target per coin age (nBits)
-    const CTxIn& txin = tx->vin[0];
+    // The v0.5 modifier only depends on the timestamp, so it is shared by
+    // all candidates; the v0.3 modifier depends on the block of the candidate
+    bool fModifierV03 = false;
+    for (unsigned int n = 0; n < nSearchInterval && n <= nTimeTx; n++) {
+        Timestamp timestamp;
+        timestamp.nTime = nTimeTx - n;
+        timestamp.fProtocolV03 = IsProtocolV03(timestamp.nTime);
+        timestamp.fProtocolV05 = IsProtocolV05(timestamp.nTime);
+        timestamp.fModifier = false;
+        timestamp.nStakeModifier = 0;
+        if (timestamp.fProtocolV05) {
+            int nStakeModifierHeight;
+            int64_t nStakeModifierTime;
+            timestamp.fModifier = GetKernelStakeModifierV05(pindexPrev, timestamp.nTime, timestamp.nStakeModifier, nStakeModifierHeight, nStakeModifierTime, false);
+        } else if (timestamp.fProtocolV03) {
+            fModifierV03 = true;
+        }
+        m_timestamps.push_back(timestamp);
+    }
+
+    bool fNegative;
+    bool fOverflow;
+    arith_uint256 bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(nBits, &fNegative, &fOverflow);
 
+    bool fSearchable = false;
+    m_candidates.reserve(vCandidates.size());
+    for (CStakeCandidate& stake : vCandidates) {
+        Candidate candidate;
+        candidate.candidate = std::move(stake);
+        candidate.fModifierV03 = false;
+        candidate.nStakeModifierV03 = 0;
+        if (fModifierV03) {
+            int nStakeModifierHeight;
+            int64_t nStakeModifierTime;
+            candidate.fModifierV03 = GetKernelStakeModifierV03(pindexPrev, candidate.candidate.kernel.hashBlock, candidate.nStakeModifierV03, nStakeModifierHeight, nStakeModifierTime, false);
+        }
+
+        // The coin-day weight only grows with the time weight, so the
+        // largest weight of the window bounds the target of every timestamp
+        int64_t nMaxTimeWeight = -1;
+        for (const Timestamp& timestamp : m_timestamps) {
+            int64_t nTimeWeight;
+            if (GetTimeWeight(candidate, timestamp, nTimeWeight)) {
+                nMaxTimeWeight = std::max(nMaxTimeWeight, nTimeWeight);
+                fSearchable = true;
+            }
+        }
+        candidate.bnTargetBound = ~arith_uint256();
+        const int64_t nValueIn = candidate.candidate.kernel.txout.nValue;
+        if (!fNegative && !fOverflow && nValueIn >= 0 && nMaxTimeWeight >= 0) {
+            const arith_uint256 bnCoinDayWeight = GetCoinDayWeight(nValueIn, nMaxTimeWeight);
+            if (bnCoinDayWeight.bits() + bnTargetPerCoinDay.bits() <= 256)
+                candidate.bnTargetBound = bnCoinDayWeight * bnTargetPerCoinDay;
+        }
+        m_candidates.push_back(std::move(candidate));
+    }
+    return fSearchable;
+}
+
+// Time weight of a candidate at a timestamp, as in CheckStakeKernelHash.
+// Returns false if the kernel would be rejected before hashing.
+bool CStakeKernelSearch::GetTimeWeight(const Candidate& candidate, const Timestamp& timestamp, int64_t& nTimeWeight) const
+{
+    const CKernelPrevout& kernel = candidate.candidate.kernel;
+    if (timestamp.nTime < kernel.GetTxTime())
+        return false;
+    if ((int64_t)kernel.nTimeBlock + m_nStakeMinAge > timestamp.nTime)
+        return false;
+    if (timestamp.fProtocolV05 ? !timestamp.fModifier : (timestamp.fProtocolV03 && !candidate.fModifierV03))
+        return false;
+    nTimeWeight = std::min((int64_t)timestamp.nTime - kernel.GetTxTime(), m_nStakeMaxAge) - (timestamp.fProtocolV03 ? m_nStakeMinAge : 0);
+    return true;
+}
+
+// Write the kernel hash message, already padded as a single SHA-256 block
+void CStakeKernelSearch::WriteKernel(const Candidate& candidate, const Timestamp& timestamp, unsigned char* block) const
+{
+    const CKernelPrevout& kernel = candidate.candidate.kernel;
+    unsigned char* p = block;
+    if (timestamp.fProtocolV03) {
+        WriteLE64(p, timestamp.fProtocolV05 ? timestamp.nStakeModifier : candidate.nStakeModifierV03);
+        p += 8;
+    } else {
+        WriteLE32(p, m_nBits);
+        p += 4;
+    }
+    WriteLE32(p, kernel.nTimeBlock);
+    WriteLE32(p + 4, kernel.nTxOffset);
+    WriteLE32(p + 8, kernel.GetTxTime());
+    WriteLE32(p + 12, candidate.candidate.prevout.n);
+    WriteLE32(p + 16, timestamp.nTime);
+    p += 20;
+    *p = 0x80;
+    std::fill(p + 1, block + 56, 0);
+    WriteBE64(block + 56, (p - block) * 8);
+}
+
+bool CStakeKernelSearch::Search(size_t nBegin, size_t nEnd, size_t& nCandidate, unsigned int& nTimeTx, uint256& hashProofOfStake, Work* pwork) const
+{
+    // Batches hold whole candidates, so the first kernel of a batch in
+    // search order is also the first one of the range
+    static const size_t KERNEL_BATCH_SIZE = 256;
+
+    nEnd = std::min(nEnd, m_candidates.size());
+    std::vector<std::pair<size_t, size_t>> vBatch; // candidate and timestamp of each kernel
+    std::vector<unsigned char> vBlocks;
+    std::vector<unsigned char> vHashes;
+    for (size_t i = nBegin; i < nEnd;) {
+        vBatch.clear();
+        const size_t nBatchBegin = i;
+        for (; i < nEnd && vBatch.size() < KERNEL_BATCH_SIZE; i++) {
+            int64_t nTimeWeight;
+            for (size_t n = 0; n < m_timestamps.size(); n++)
+                if (GetTimeWeight(m_candidates[i], m_timestamps[n], nTimeWeight))
+                    vBatch.emplace_back(i, n);
+        }
+        if (pwork) {
+            pwork->nScanned += i - nBatchBegin;
+            pwork->nHashes += vBatch.size();
+        }
+        if (vBatch.empty())
+            continue;
+
+        vBlocks.resize(vBatch.size() * 64);
+        vHashes.resize(vBatch.size() * 32);
+        for (size_t k = 0; k < vBatch.size(); k++)
+            WriteKernel(m_candidates[vBatch[k].first], m_timestamps[vBatch[k].second], &vBlocks[k * 64]);
+        SHA256DSingleBlock(vHashes.data(), vBlocks.data(), vBatch.size());
+
+        for (size_t k = 0; k < vBatch.size(); k++) {
+            const Candidate& candidate = m_candidates[vBatch[k].first];
+            const Timestamp& timestamp = m_timestamps[vBatch[k].second];
+            uint256 hash;
+            memcpy(hash.begin(), &vHashes[k * 32], 32);
+            if (UintToArith256(hash) > candidate.bnTargetBound)
+                continue;
+            int64_t nTimeWeight;
+            GetTimeWeight(candidate, timestamp, nTimeWeight);
+            if (CheckStakeKernelTarget(m_nBits, candidate.candidate.kernel.txout.nValue, nTimeWeight, hash)) {
+                nCandidate = vBatch[k].first;
+                nTimeTx = timestamp.nTime;
+                hashProofOfStake = hash;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static std::atomic<uint64_t> nKernelPrevoutDiskReads{0};
+
+uint64_t GetKernelPrevoutDiskReads()
+{
+    return nKernelPrevoutDiskReads;
+}
+
+// Build the kernel prevout record from the transaction index and block files
+bool ReadKernelPrevoutFromDisk(const COutPoint& prevout, CKernelPrevout& kernel)
+{
     // Transaction index is required to get to block header
     if (!g_txindex)
-        return error("CheckProofOfStake() : transaction index not available");
+        return error("ReadKernelPrevoutFromDisk() : transaction index not available");
 
     // Get transaction index for the previous transaction
     CDiskTxPos postx;
-    if (!g_txindex->FindTxPosition(txin.prevout.hash, postx))
-        return error("CheckProofOfStake() : tx index not found");  // tx index not found
+    if (!g_txindex->FindTxPosition(prevout.hash, postx))
+        return error("ReadKernelPrevoutFromDisk() : tx index not found");  // tx index not found
 
     // Read txPrev and header of its block
     CBlockHeader header;
     CTransactionRef txPrev;
     {
+        nKernelPrevoutDiskReads++;
         CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
         try {
             file >> header;
             fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
             file >> txPrev;
         } catch (std::exception &e) {
-            return error("%s() : deserialize or I/O error in CheckProofOfStake()", __PRETTY_FUNCTION__);
+            return error("%s() : deserialize or I/O error in ReadKernelPrevoutFromDisk()", __PRETTY_FUNCTION__);
         }
-        if (txPrev->GetHash() != txin.prevout.hash)
-            return error("%s() : txid mismatch in CheckProofOfStake()", __PRETTY_FUNCTION__);
+        if (txPrev->GetHash() != prevout.hash)
+            return error("%s() : txid mismatch in ReadKernelPrevoutFromDisk()", __PRETTY_FUNCTION__);
+        if (prevout.n >= txPrev->vout.size())
+            return error("%s() : prevout out of range in ReadKernelPrevoutFromDisk()", __PRETTY_FUNCTION__);
     }
 
-    // Verify signature
-    {
-        int nIn = 0;
-        const CTxOut& prevOut = txPrev->vout[tx->vin[nIn].prevout.n];
-        TransactionSignatureChecker checker(&(*tx), nIn, prevOut.nValue, PrecomputedTransactionData(*tx));
+    kernel = CKernelPrevout(header.GetHash(), header.nTime, postx.nTxOffset + CBlockHeader::NORMAL_SERIALIZE_SIZE, txPrev->nTime, txPrev->vout[prevout.n]);
+    return true;
+}
 
-        if (!VerifyScript(tx->vin[nIn].scriptSig, prevOut.scriptPubKey, &(tx->vin[nIn].scriptWitness), SCRIPT_VERIFY_P2SH, checker, nullptr))
-            return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "invalid-pos-script", strprintf("%s: VerifyScript failed on coinstake %s", __func__, tx->GetHash().ToString()));
+// Get the kernel prevout record, preferring the block tree database cache
+bool GetKernelPrevout(const CBlockIndex* pindexPrev, const COutPoint& prevout, CKernelPrevout& kernel)
+{
+    // A cached record is only trusted if its block is on the chain we are
+    // checking against; anything else (side branches, records written before
+    // a reorg) goes through the block files like before
+    if (pblocktree->ReadKernelPrevout(prevout, kernel)) {
+        const CBlockIndex* pindexFrom = LookupBlockIndex(kernel.hashBlock);
+        if (pindexFrom && pindexPrev && pindexPrev->GetAncestor(pindexFrom->nHeight) == pindexFrom)
+            return true;
     }
 
-    if (!CheckStakeKernelHash(nBits, pindexPrev, header, postx.nTxOffset + CBlockHeader::NORMAL_SERIALIZE_SIZE, txPrev, txin.prevout, nTimeTx, hashProofOfStake, gArgs.GetBoolArg("-debug", false)))
+    if (!ReadKernelPrevoutFromDisk(prevout, kernel))
+        return false;
+
+    // Remember outputs that were confirmed before the cache existed
+    const CBlockIndex* pindexFrom = LookupBlockIndex(kernel.hashBlock);
+    if (pindexFrom && pindexPrev && pindexPrev->GetAncestor(pindexFrom->nHeight) == pindexFrom)
+        pblocktree->UpdateKernelPrevoutIndex({std::make_pair(prevout, kernel)});
+    return true;
+}
+
+// Check kernel hash target and coinstake signature
+bool CheckProofOfStake(BlockValidationState &state, CBlockIndex* pindexPrev, const CTransactionRef& tx, unsigned int nBits, uint256& hashProofOfStake, unsigned int nTimeTx, PrecomputedTransactionData& txdata, std::vector<CScriptCheck>* pvChecks)
+{
+    if (!tx->IsCoinStake())
+        return error("CheckProofOfStake() : called on non-coinstake %s", tx->GetHash().ToString());
+
+    // Kernel (input 0) must match the stake hash target per coin age (nBits)
+    const CTxIn& txin = tx->vin[0];
+
+    // Get block time, offset and output of the previous transaction
+    CKernelPrevout kernel;
+    if (!GetKernelPrevout(pindexPrev, txin.prevout, kernel))
+        return error("CheckProofOfStake() : kernel prevout %s not found", txin.prevout.ToString());
+
+    // Verify signature, caching it for when the coinstake inputs are checked
+    // in ConnectBlock
+    CScriptCheck check(kernel.txout, *tx, 0, SCRIPT_VERIFY_P2SH, true, &txdata);
+    if (pvChecks) {
+        pvChecks->push_back(CScriptCheck());
+        check.swap(pvChecks->back());
+    } else if (!check()) {
+        return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "invalid-pos-script", strprintf("%s: VerifyScript failed on coinstake %s", __func__, tx->GetHash().ToString()));
+    }
+
+    if (!CheckStakeKernelHash(nBits, pindexPrev, kernel, txin.prevout, nTimeTx, hashProofOfStake, gArgs.GetBoolArg("-debug", false)))
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "check-kernel-failed", strprintf("CheckProofOfStake() : INFO: check kernel failed on coinstake %s, hashProof=%s", tx->GetHash().ToString(), hashProofOfStake.ToString())); // may occur during initial download or if behind on block chain sync
 
     return true;
@@ -646,6 +1064,10 @@ bool CheckStakeModifierCheckpoints(int nHeight, unsigned int nStakeModifierCheck
 bool IsSuperMajority(int minVersion, const CBlockIndex* pstart, unsigned int nRequired, unsigned int nToCheck)
 {
     unsigned int nFound = 0;
+    // Block index entries count the versions of tracked soft forks
+    if (pstart && pstart->CountStakeVersion(minVersion, nToCheck, nFound))
+        return (nFound >= nRequired);
+
     for (unsigned int i = 0; i < nToCheck && nFound < nRequired && pstart != NULL; pstart = pstart->pprev )
     {
         if (!pstart->IsProofOfStake())
@@ -4,12 +4,19 @@
 #ifndef SUMCOIN_KERNEL_H
 #define SUMCOIN_KERNEL_H
 
+#include <arith_uint256.h>
+#include <kernelprevout.h>
 #include <primitives/transaction.h> // CTransaction(Ref)
 
+#include <vector>
+
 class CBlockIndex;
+class CChain;
 class BlockValidationState;
 class CBlockHeader;
 class CBlock;
+class CScriptCheck;
+struct PrecomputedTransactionData;
 
 
 // MODIFIER_INTERVAL_RATIO:
@@ -41,13 +48,147 @@ bool IsProtocolV10(unsigned int nTimeTx);
 // Compute the hash modifier for proof-of-stake
 bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier);
 
+/**
+ * The stake modifier generations of a chain in chain order, so that the
+ * modifier of a kernel is found by binary search instead of by walking the
+ * chain block by block. The timeline follows one chain, normally the active
+ * chain, and catches up with it on use. Blocks on a side branch are resolved
+ * against the timeline up to the fork point and the generations on the branch
+ * above it. Results are the same as walking the chain.
+ */
+class CStakeModifierTimeline
+{
+public:
+    struct Entry {
+        int64_t nTime; // time of the block that generated the modifier
+        uint64_t nStakeModifier;
+        int nHeight;
+        uint256 hashBlock;
+        int64_t nTimeMax; // latest generation time up to this entry
+        size_t nDescent;  // last entry up to this one timed before the entry preceding it (0 if none)
+    };
+
+    // Latest generation below the height of pindexPrev, on its chain, whose
+    // time is at most nTimeMax (v0.5 kernel modifier)
+    bool FindLatestAtOrBefore(const CChain& chain, const CBlockIndex* pindexPrev, int64_t nTimeMax, Entry& entry);
+
+    // First generation above pindexFrom up to pindexLast, on the chain of
+    // pindexLast, whose time is at least nTimeMin (v0.3 kernel modifier).
+    // pindexFrom must be an ancestor of pindexLast.
+    bool FindFirstAtOrAfter(const CChain& chain, const CBlockIndex* pindexFrom, const CBlockIndex* pindexLast, int64_t nTimeMin, Entry& entry);
+
+    size_t size() const { return m_entries.size(); }
+
+private:
+    std::vector<Entry> m_entries;
+    int m_nHeight{-1}; // height of the chain the timeline has caught up with
+    uint256 m_hashTip; // block at that height
+
+    void Sync(const CChain& chain);
+    void Append(const CBlockIndex* pindex);
+    // Index of the first entry above a height
+    size_t UpperBound(int nHeight) const;
+};
+
+// Get the kernel prevout record of an output, from the block tree database
+// if it is cached for the chain ending at pindexPrev, else from the
+// transaction index and block files
+bool GetKernelPrevout(const CBlockIndex* pindexPrev, const COutPoint& prevout, CKernelPrevout& kernel);
+
+// Build the kernel prevout record of an output from the transaction index
+// and block files, bypassing the block tree database cache
+bool ReadKernelPrevoutFromDisk(const COutPoint& prevout, CKernelPrevout& kernel);
+
+// Number of kernel prevout records read from the block files since startup
+uint64_t GetKernelPrevoutDiskReads();
+
+// Check whether a kernel hash meets the target per coin day (nBits) weighted
+// by the coin-day weight of a stake with the given value and time weight
+bool CheckStakeKernelTarget(unsigned int nBits, int64_t nValueIn, int64_t nTimeWeight, const uint256& hashProofOfStake);
+
 // Check whether stake kernel meets hash target
 // Sets hashProofOfStake on success return
-bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBlockHeader& blockFrom, unsigned int nTxPrevOffset, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake=false);
+bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CKernelPrevout& kernel, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake=false);
+
+// A wallet output that may become the kernel of a coinstake
+struct CStakeCandidate
+{
+    COutPoint prevout;
+    CKernelPrevout kernel;
+};
+
+// A kernel found by a stake kernel search
+struct CStakeKernel
+{
+    COutPoint prevout;
+    unsigned int nTimeTx;
+    uint256 hashProofOfStake;
+};
+
+/**
+ * Batched stake kernel search over many candidate outputs and a window of
+ * coinstake timestamps, equivalent to calling CheckStakeKernelHash for each
+ * candidate in order and for each timestamp from the latest backwards.
+ *
+ * Prepare() resolves the stake modifiers, which needs cs_main, and lays out
+ * the invariant part of every kernel hash. Search() only hashes, using the
+ * multi-way double SHA-256 transforms, and compares against the weighted
+ * targets, so disjoint ranges of candidates can be searched without holding
+ * any lock.
+ */
+class CStakeKernelSearch
+{
+public:
+    bool Prepare(unsigned int nBits, CBlockIndex* pindexPrev, unsigned int nTimeTx, unsigned int nSearchInterval, std::vector<CStakeCandidate> vCandidates);
+
+    // Work done by a search, for the minter counters
+    struct Work {
+        uint64_t nScanned{0}; // candidates whose kernels were hashed
+        uint64_t nHashes{0};  // kernel hashes
+    };
+
+    // Find the first kernel among candidates [nBegin, nEnd). On success sets
+    // the candidate index, its coinstake timestamp and hashProofOfStake.
+    // If pwork is not null, the work done is added to it.
+    bool Search(size_t nBegin, size_t nEnd, size_t& nCandidate, unsigned int& nTimeTx, uint256& hashProofOfStake, Work* pwork = nullptr) const;
+
+    size_t size() const { return m_candidates.size(); }
+    const CStakeCandidate& operator[](size_t i) const { return m_candidates[i].candidate; }
+
+private:
+    // Kernel protocol and stake modifier of one timestamp in the window
+    struct Timestamp {
+        unsigned int nTime;
+        bool fProtocolV03;
+        bool fProtocolV05;
+        bool fModifier; // V0.5 stake modifier available
+        uint64_t nStakeModifier;
+    };
+
+    struct Candidate {
+        CStakeCandidate candidate;
+        bool fModifierV03; // V0.3 stake modifier available
+        uint64_t nStakeModifierV03;
+        // Upper bound of the weighted target over the window; hashes above
+        // it fail without evaluating the exact target
+        arith_uint256 bnTargetBound;
+    };
+
+    unsigned int m_nBits{0};
+    int64_t m_nStakeMinAge{0};
+    int64_t m_nStakeMaxAge{0};
+    std::vector<Timestamp> m_timestamps;
+    std::vector<Candidate> m_candidates;
+
+    bool GetTimeWeight(const Candidate& candidate, const Timestamp& timestamp, int64_t& nTimeWeight) const;
+    void WriteKernel(const Candidate& candidate, const Timestamp& timestamp, unsigned char* block) const;
+};
 
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
-bool CheckProofOfStake(BlockValidationState &state, CBlockIndex* pindexPrev, const CTransactionRef &tx, unsigned int nBits, uint256& hashProofOfStake, unsigned int nTimeTx);
+// If pvChecks is not null, the signature check is appended to it instead of
+// run, with txdata precomputed for the coinstake and outliving the check
+bool CheckProofOfStake(BlockValidationState &state, CBlockIndex* pindexPrev, const CTransactionRef &tx, unsigned int nBits, uint256& hashProofOfStake, unsigned int nTimeTx, PrecomputedTransactionData& txdata, std::vector<CScriptCheck>* pvChecks = nullptr);
 
 // Check whether the coinstake timestamp meets protocol
 bool CheckCoinStakeTimestamp(int64_t nTimeBlock, int64_t nTimeTx);
@@ -0,0 +1,59 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SUMCOIN_KERNELPREVOUT_H
+#define SUMCOIN_KERNELPREVOUT_H
+
+#include <compressor.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+
+/**
+ * sumcoin: everything the stake kernel needs to know about a transaction
+ * output, so that kernel checks do not have to read the block file that
+ * contains the transaction. Records are keyed by outpoint.
+ */
+struct CKernelPrevout {
+    uint256 hashBlock;       // block containing the transaction
+    unsigned int nTimeBlock; // timestamp of that block
+    unsigned int nTxOffset;  // offset of the transaction from the start of the block (header included)
+    unsigned int nTimeTx;    // transaction timestamp (0 if the transaction has none)
+    CTxOut txout;
+
+    SERIALIZE_METHODS(CKernelPrevout, obj)
+    {
+        READWRITE(obj.hashBlock, obj.nTimeBlock, VARINT(obj.nTxOffset), obj.nTimeTx, Using<TxOutCompression>(obj.txout));
+    }
+
+    CKernelPrevout(const uint256& hashBlockIn, unsigned int nTimeBlockIn, unsigned int nTxOffsetIn, unsigned int nTimeTxIn, const CTxOut& txoutIn)
+        : hashBlock(hashBlockIn), nTimeBlock(nTimeBlockIn), nTxOffset(nTxOffsetIn), nTimeTx(nTimeTxIn), txout(txoutIn) {}
+
+    CKernelPrevout()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        hashBlock.SetNull();
+        nTimeBlock = 0;
+        nTxOffset = 0;
+        nTimeTx = 0;
+        txout.SetNull();
+    }
+
+    bool IsNull() const
+    {
+        return hashBlock.IsNull();
+    }
+
+    // Transaction timestamp as used by the kernel protocol
+    unsigned int GetTxTime() const
+    {
+        return nTimeTx ? nTimeTx : nTimeBlock;
+    }
+};
+
+#endif // SUMCOIN_KERNELPREVOUT_H
@@ -1,10 +1,8 @@
 #include <kernelrecord.h>
-#include <key_io.h>
 #include <wallet/wallet.h>
 #include <base58.h>
 #include <chainparams.h>
 #include <timedata.h>
-#include <interfaces/wallet.h>
 #include <math.h>
 using namespace std;
 
@@ -21,46 +19,6 @@ bool KernelRecord::showTransaction(bool isCoinbase, int depth)
     return true;
 }
 
-/*
- * Decompose CWallet transaction to model kernel records.
- */
-vector<KernelRecord> KernelRecord::decomposeOutput(interfaces::Wallet& wallet, const interfaces::WalletTx &wtx)
-{
-    vector<KernelRecord> parts;
-    int64_t nTime = (wtx.tx->nTime ? wtx.tx->nTime : wtx.time);
-    uint256 hash = wtx.tx->GetHash();
-    std::map<std::string, std::string> mapValue = wtx.value_map;
-
-    int numBlocks;
-    interfaces::WalletTxStatus status;
-    interfaces::WalletOrderForm orderForm;
-    bool inMempool;
-    wallet.getWalletTxDetails(hash, status, orderForm, inMempool, numBlocks);
-
-    if (showTransaction(wtx.is_coinbase, status.depth_in_main_chain)) {
-        for (size_t nOut = 0; nOut < wtx.tx->vout.size(); nOut++) {
-            CTxOut txOut = wtx.tx->vout[nOut];
-            if (wallet.txoutIsMine(txOut)) {
-                CTxDestination address;
-                std::string addrStr;
-
-                if (ExtractDestination(txOut.scriptPubKey, address)) {
-                    // Sent to Bitcoin Address
-                    addrStr = EncodeDestination(address);
-                } else {
-                    // Sent to IP, or other non-address transaction like OP_EVAL
-                    addrStr = mapValue["to"];
-                }
-                std::vector<interfaces::WalletTxOut> coins = wallet.getCoins({COutPoint(hash, nOut)});
-                bool isSpent = coins.size() >= 1 ? coins[0].is_spent : true;
-                parts.push_back(KernelRecord(hash, nTime, addrStr, txOut.nValue, nOut, isSpent));
-            }
-        }
-    }
-
-    return parts;
-}
-
 std::string KernelRecord::getTxID()
 {
     return hash.ToString() + strprintf("-%03d", idx);
@@ -88,33 +46,62 @@ double KernelRecord::getProbToMintStake(double difficulty, int timeOffset) const
     return target * coinAge / pow(static_cast<double>(2), 256);
 }
 
+int64_t KernelRecord::getAgeDay() const
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    int64_t nAge = GetAdjustedTime() - nTime - params.nStakeMinAge;
+    return nAge >= 0 ? nAge / 86400 : -((-nAge + 86399) / 86400);
+}
+
+double KernelRecord::getProbToMintStakeAtDayWeight(double difficulty, int64_t dayWeight) const
+{
+    double maxTarget = pow(static_cast<double>(2), 224);
+    double target = maxTarget / difficulty;
+    uint64_t coinAge = max(nValue * dayWeight / COIN, (int64_t)0);
+    return target * coinAge / pow(static_cast<double>(2), 256);
+}
+
 double KernelRecord::getProbToMintWithinNMinutes(double difficulty, int minutes)
 {
-    if(difficulty != prevDifficulty || minutes != prevMinutes)
-    {
-        double prob = 1;
-        double p;
-        int d = minutes / (60 * 24); // Number of full days
-        int m = minutes % (60 * 24); // Number of minutes in the last day
-        int i, timeOffset;
+    // The coin-day weight only changes at day boundaries of the coin age, so
+    // a probability holds until the difficulty or the day changes
+    const int64_t nAgeDay = getAgeDay();
+    for (const MintProbability& cached : vProbabilities) {
+        if (cached.minutes == minutes && cached.difficulty == difficulty && cached.nAgeDay == nAgeDay)
+            return cached.probability;
+    }
+
+    const Consensus::Params& params = Params().GetConsensus();
+    // Day weight at time offset i days is the age day plus i, up to the
+    // stake max age
+    const int64_t nMaxDayWeight = (params.nStakeMaxAge - params.nStakeMinAge) / 86400;
+    double prob = 1;
+    int d = minutes / (60 * 24); // Number of full days
+    int m = minutes % (60 * 24); // Number of minutes in the last day
 
-        // Probabilities for the first d days
-        for(i = 0; i < d; i++)
-        {
-            timeOffset = i * 86400;
-            p = pow(1 - getProbToMintStake(difficulty, timeOffset), 86400);
-            prob *= p;
+    // Probabilities for the first d days; once the coin age reaches the max
+    // age every remaining day has the same probability
+    for (int i = 0; i < d; i++) {
+        const int64_t dayWeight = nAgeDay + i;
+        if (dayWeight <= 0)
+            continue;
+        if (dayWeight >= nMaxDayWeight) {
+            prob *= pow(1 - getProbToMintStakeAtDayWeight(difficulty, nMaxDayWeight), 86400.0 * (d - i));
+            break;
         }
+        prob *= pow(1 - getProbToMintStakeAtDayWeight(difficulty, dayWeight), 86400);
+    }
 
-        // Probability for the m minutes of the last day
-        timeOffset = d * 86400;
-        p = pow(1 - getProbToMintStake(difficulty, timeOffset), 60 * m);
-        prob *= p;
+    // Probability for the m minutes of the last day
+    prob *= pow(1 - getProbToMintStakeAtDayWeight(difficulty, min(nAgeDay + d, nMaxDayWeight)), 60 * m);
 
-        prob = 1 - prob;
-        prevProbability = prob;
-        prevDifficulty = difficulty;
-        prevMinutes = minutes;
+    prob = 1 - prob;
+    for (MintProbability& cached : vProbabilities) {
+        if (cached.minutes == minutes) {
+            cached = {minutes, difficulty, nAgeDay, prob};
+            return prob;
+        }
     }
-    return prevProbability;
+    vProbabilities.push_back({minutes, difficulty, nAgeDay, prob});
+    return prob;
 }
@@ -5,21 +5,20 @@
 #define SUMCOIN_KERNELRECORD_H
 
 #include <uint256.h>
-#include <interfaces/wallet.h>
 
-class CWallet;
-class CWalletTx;
+#include <string>
+#include <vector>
 
 class KernelRecord
 {
 public:
     KernelRecord():
-        hash(), nTime(0), address(""), nValue(0), idx(0), spent(false), prevMinutes(0), prevDifficulty(0), prevProbability(0)
+        hash(), nTime(0), address(""), nValue(0), idx(0), spent(false)
     {
     }
 
     KernelRecord(uint256 hash, int64_t nTime):
-            hash(hash), nTime(nTime), address(""), nValue(0), idx(0), spent(false), prevMinutes(0), prevDifficulty(0), prevProbability(0)
+            hash(hash), nTime(nTime), address(""), nValue(0), idx(0), spent(false)
     {
     }
 
@@ -27,12 +26,11 @@ public:
                  const std::string &address,
                  int64_t nValue, int idx, bool spent):
         hash(hash), nTime(nTime), address(address), nValue(nValue),
-        idx(idx), spent(spent), prevMinutes(0), prevDifficulty(0), prevProbability(0)
+        idx(idx), spent(spent)
     {
     }
 
     static bool showTransaction(bool isCoinbase, int depth);
-    static std::vector<KernelRecord> decomposeOutput(interfaces::Wallet &wallet, const interfaces::WalletTx &wtx);
 
 
     uint256 hash;
@@ -48,9 +46,19 @@ public:
     double getProbToMintStake(double difficulty, int timeOffset = 0) const;
     double getProbToMintWithinNMinutes(double difficulty, int minutes);
 protected:
-    int prevMinutes;
-    double prevDifficulty;
-    double prevProbability;
+    // Probability of a horizon, valid for a difficulty and a day of coin age
+    struct MintProbability {
+        int minutes;
+        double difficulty;
+        int64_t nAgeDay;
+        double probability;
+    };
+    std::vector<MintProbability> vProbabilities;
+
+    // Days past the stake min age, rounded down, that the coin-day weight
+    // of every time offset follows from
+    int64_t getAgeDay() const;
+    double getProbToMintStakeAtDayWeight(double difficulty, int64_t dayWeight) const;
 };
 
 #endif // SUMCOIN_KERNELRECORD_H
@@ -7,6 +7,7 @@
 
 #include <amount.h>
 #include <chain.h>
+#include <checkqueue.h>
 #include <chainparams.h>
 #include <coins.h>
 #include <consensus/consensus.h>
@@ -28,10 +29,13 @@
 #include <warnings.h>
 
 #include <algorithm>
+#include <atomic>
+#include <limits>
 #include <utility>
 
 #include <boost/thread.hpp>
 int64_t nLastCoinStakeSearchInterval = 0;
+CStakeMinterStats g_stake_minter_stats;
 int64_t UpdateTime(CBlockHeader* pblock)
 {
     int64_t nOldTime = pblock->nTime;
@@ -85,7 +89,7 @@ Optional<int64_t> BlockAssembler::m_last_block_num_txs{nullopt};
 Optional<int64_t> BlockAssembler::m_last_block_weight{nullopt};
 
 // sumcoin: if pwallet != NULL it will attempt to create coinstake
-std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet, bool* pfPoSCancel)
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet, bool* pfPoSCancel, const CStakeKernel* pkernel)
 {
     int64_t nTimeStart = GetTimeMicros();
 
@@ -129,7 +133,19 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
         pblock->nBits = GetNextTargetRequired(pindexPrev, true, chainparams.GetConsensus());
         CMutableTransaction txCoinStake;
         int64_t nSearchTime = txCoinStake.nTime; // search to current time
-        if (nSearchTime > nLastCoinStakeSearchTime)
+        if (pkernel)
+        {
+            // kernel already found by the stake minter
+            if (pwallet->CreateCoinStake(pwallet, pblock->nBits, 0, txCoinStake, pkernel) &&
+                txCoinStake.nTime >= std::max(pindexPrev->GetMedianTimePast()+1, pindexPrev->GetBlockTime() - (IsProtocolV09(pindexPrev->GetBlockTime()) ? MAX_FUTURE_BLOCK_TIME : MAX_FUTURE_BLOCK_TIME_PREV9)))
+            {
+                coinbaseTx.vout[0].SetEmpty();
+                coinbaseTx.nTime = txCoinStake.nTime;
+                pblock->vtx.push_back(MakeTransactionRef(CTransaction(txCoinStake)));
+                *pfPoSCancel = false;
+            }
+        }
+        else if (nSearchTime > nLastCoinStakeSearchTime)
         {
             if (pwallet->CreateCoinStake(pwallet, pblock->nBits, nSearchTime-nLastCoinStakeSearchTime, txCoinStake))
             {
@@ -497,6 +513,124 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
     return true;
 }
 
+// sumcoin: first kernel found by the stake kernel search workers
+struct StakeKernelResult {
+    Mutex cs;
+    std::atomic<size_t> nCandidate{std::numeric_limits<size_t>::max()};
+    unsigned int nTimeTx GUARDED_BY(cs){0};
+    uint256 hashProofOfStake GUARDED_BY(cs);
+    std::atomic<uint64_t> nScanned{0};
+    std::atomic<uint64_t> nHashes{0};
+};
+
+// sumcoin: search of a range of stake kernel candidates by one worker
+class CStakeKernelCheck
+{
+private:
+    const CStakeKernelSearch* search{nullptr};
+    size_t nBegin{0};
+    size_t nEnd{0};
+    StakeKernelResult* result{nullptr};
+
+public:
+    CStakeKernelCheck() {}
+    CStakeKernelCheck(const CStakeKernelSearch& searchIn, size_t nBeginIn, size_t nEndIn, StakeKernelResult& resultIn) :
+        search(&searchIn), nBegin(nBeginIn), nEnd(nEndIn), result(&resultIn) {}
+
+    bool operator()()
+    {
+        // Skip ranges after a candidate that already has a kernel
+        if (nBegin >= result->nCandidate)
+            return true;
+        size_t nCandidate;
+        unsigned int nTimeTx;
+        uint256 hashProofOfStake;
+        CStakeKernelSearch::Work work;
+        const bool fFound = search->Search(nBegin, nEnd, nCandidate, nTimeTx, hashProofOfStake, &work);
+        result->nScanned += work.nScanned;
+        result->nHashes += work.nHashes;
+        if (fFound) {
+            LOCK(result->cs);
+            if (nCandidate < result->nCandidate) {
+                result->nCandidate = nCandidate;
+                result->nTimeTx = nTimeTx;
+                result->hashProofOfStake = hashProofOfStake;
+            }
+        }
+        return true;
+    }
+
+    void swap(CStakeKernelCheck& check)
+    {
+        std::swap(search, check.search);
+        std::swap(nBegin, check.nBegin);
+        std::swap(nEnd, check.nEnd);
+        std::swap(result, check.result);
+    }
+};
+
+static CCheckQueue<CStakeKernelCheck> stakekernelqueue(1);
+static int nStakeThreads = DEFAULT_STAKE_THREADS;
+// Candidates per check, about a millisecond of hashing over a full window
+static const size_t STAKE_KERNEL_CHECK_SIZE = 128;
+// Longest sleep of the stake minter waiting for a coin to become old enough,
+// in seconds; coins confirmed meanwhile are at least a day away from staking
+// but immature coinstakes only mature with blocks
+static const int64_t MAX_STAKE_IDLE_SLEEP = 10 * 60;
+
+// sumcoin: adds the time a scope ran to a minter counter; declared after a
+// lock, it times the hold of the lock
+class CStakeLockTimer
+{
+private:
+    std::atomic<uint64_t>& m_counter;
+    const int64_t m_nStart;
+
+public:
+    explicit CStakeLockTimer(std::atomic<uint64_t>& counter) : m_counter(counter), m_nStart(GetTimeMicros()) {}
+
+    ~CStakeLockTimer()
+    {
+        const uint64_t nMicros = GetTimeMicros() - m_nStart;
+        m_counter += nMicros;
+        uint64_t nMax = g_stake_minter_stats.nMaxLockMicros;
+        while (nMicros > nMax && !g_stake_minter_stats.nMaxLockMicros.compare_exchange_weak(nMax, nMicros)) {}
+    }
+};
+
+// sumcoin: search a prepared kernel search on all stake threads, finding the
+// same kernel as a single threaded search. The work done is added to work.
+static bool SearchStakeKernel(const CStakeKernelSearch& search, CStakeKernel& kernel, CStakeKernelSearch::Work& work)
+{
+    size_t nCandidate;
+    if (nStakeThreads <= 1) {
+        if (!search.Search(0, search.size(), nCandidate, kernel.nTimeTx, kernel.hashProofOfStake, &work))
+            return false;
+        kernel.prevout = search[nCandidate].prevout;
+        return true;
+    }
+
+    StakeKernelResult result;
+    std::vector<CStakeKernelCheck> vChecks;
+    // The queue hands out checks from the back, so add the first ones last
+    for (size_t i = (search.size() + STAKE_KERNEL_CHECK_SIZE - 1) / STAKE_KERNEL_CHECK_SIZE; i-- > 0;)
+        vChecks.emplace_back(search, i * STAKE_KERNEL_CHECK_SIZE, std::min((i + 1) * STAKE_KERNEL_CHECK_SIZE, search.size()), result);
+    CCheckQueueControl<CStakeKernelCheck> control(&stakekernelqueue);
+    control.Add(vChecks);
+    control.Wait();
+    work.nScanned += result.nScanned;
+    work.nHashes += result.nHashes;
+
+    LOCK(result.cs);
+    nCandidate = result.nCandidate;
+    if (nCandidate >= search.size())
+        return false;
+    kernel.prevout = search[nCandidate].prevout;
+    kernel.nTimeTx = result.nTimeTx;
+    kernel.hashProofOfStake = result.hashProofOfStake;
+    return true;
+}
+
 void PoSMiner(std::shared_ptr<CWallet> pwallet, CConnman* connman, CTxMemPool* mempool)
 {
     LogPrintf("CPUMiner started for proof-of-stake\n");
@@ -507,20 +641,18 @@ void PoSMiner(std::shared_ptr<CWallet> pwallet, CConnman* connman, CTxMemPool* m
     OutputType output_type = pwallet->m_default_change_type != OutputType::CHANGE_AUTO ? pwallet->m_default_change_type : pwallet->m_default_address_type;
     ReserveDestination reservedest(pwallet.get(), output_type);
     CTxDestination dest;
-    // Compute timeout for pos as sqrt(numUTXO)
-    unsigned int pos_timio;
     {
         LOCK2(cs_main, pwallet->cs_wallet);
 
         if (!reservedest.GetReservedDestination(dest, true))
             throw std::runtime_error("Error: Keypool ran out, please call keypoolrefill first");
-
-        std::vector<COutput> vCoins;
-        CCoinControl coincontrol;
-        pwallet->AvailableCoins(*pwallet->chain().lock(), vCoins, false, &coincontrol);
-        pos_timio = gArgs.GetArg("-staketimio", 500) + 30 * sqrt(vCoins.size());
-        LogPrintf("Set proof-of-stake timeout: %ums for %u UTXOs\n", pos_timio, vCoins.size());
     }
+    // The kernel search holds no lock, so the pause between searches no
+    // longer has to grow with the number of coins
+    const unsigned int pos_timio = gArgs.GetArg("-staketimio", 500);
+    LogPrintf("Set proof-of-stake timeout: %ums\n", pos_timio);
+    const CBlockIndex* pindexLastSearch = nullptr;
+    unsigned int nLastSearchTime = 0;
 
     std::string strMintMessage = _("Info: Minting suspended due to locked wallet.").translated;
     std::string strMintSyncMessage = _("Info: Minting suspended while synchronizing wallet.").translated;
@@ -573,19 +705,84 @@ void PoSMiner(std::shared_ptr<CWallet> pwallet, CConnman* connman, CTxMemPool* m
                 fNeedToClear = false;
             }
 
+            //
+            // Search for a kernel on a snapshot of the stake candidates
+            //
+            CBlockIndex* pindexPrev;
+            CStakeKernelSearch search;
+            bool fSearchable = false;
+            unsigned int nNextStakeTime = 0;
+            const uint64_t nDiskReads = GetKernelPrevoutDiskReads();
+            {
+                LOCK2(cs_main, pwallet->cs_wallet);
+                CStakeLockTimer timer(g_stake_minter_stats.nPrepareLockMicros);
+                pindexPrev = ::ChainActive().Tip();
+                const unsigned int nBits = GetNextTargetRequired(pindexPrev, true, Params().GetConsensus());
+                const unsigned int nSearchTime = GetAdjustedTime();
+                // A new tip changes the target and possibly the stake
+                // modifier, so the whole window is searched again; otherwise
+                // only the seconds since the last search are new
+                int64_t nSearchInterval = MAX_STAKE_SEARCH_INTERVAL;
+                if (pindexPrev == pindexLastSearch)
+                    nSearchInterval = std::min<int64_t>((int64_t)nSearchTime - nLastSearchTime, MAX_STAKE_SEARCH_INTERVAL);
+                std::vector<CStakeCandidate> vCandidates;
+                if (nSearchInterval > 0) {
+                    if (pwallet->GetStakeCandidates(nSearchTime, vCandidates, nNextStakeTime))
+                        fSearchable = search.Prepare(nBits, pindexPrev, nSearchTime, nSearchInterval, std::move(vCandidates));
+                    if (nLastSearchTime != 0) {
+                        const uint64_t nElapsed = nSearchTime - nLastSearchTime;
+                        g_stake_minter_stats.nWindowSearched += std::min<uint64_t>(nSearchInterval, nElapsed);
+                        g_stake_minter_stats.nWindowElapsed += nElapsed;
+                    }
+                    nLastCoinStakeSearchInterval = nSearchInterval;
+                    pindexLastSearch = pindexPrev;
+                    nLastSearchTime = nSearchTime;
+                }
+            }
+
+            CStakeKernel kernel;
+            CStakeKernelSearch::Work work;
+            const int64_t nSearchStart = GetTimeMicros();
+            const bool fFound = fSearchable && SearchStakeKernel(search, kernel, work);
+            const int64_t nFoundTime = GetTimeMicros();
+            if (fSearchable) {
+                g_stake_minter_stats.nTicks++;
+                g_stake_minter_stats.nEligible += search.size();
+                g_stake_minter_stats.nLastEligible = search.size();
+                g_stake_minter_stats.nScanned += work.nScanned;
+                g_stake_minter_stats.nLastScanned = work.nScanned;
+                g_stake_minter_stats.nKernelsHashed += work.nHashes;
+                g_stake_minter_stats.nSearchMicros += nFoundTime - nSearchStart;
+                const uint64_t nTickDiskReads = GetKernelPrevoutDiskReads() - nDiskReads;
+                g_stake_minter_stats.nDiskReads += nTickDiskReads;
+                g_stake_minter_stats.nLastDiskReads = nTickDiskReads;
+            }
+            if (!fFound) {
+                // With no coin old enough to stake, sleep until the next one is
+                int64_t nSleep = pos_timio;
+                if (!fSearchable && nNextStakeTime > GetAdjustedTime())
+                    nSleep = std::max<int64_t>(nSleep, std::min<int64_t>(nNextStakeTime - GetAdjustedTime(), MAX_STAKE_IDLE_SLEEP) * 1000);
+                if (!connman->interruptNet.sleep_for(std::chrono::milliseconds(nSleep)))
+                    return;
+                continue;
+            }
+
             //
             // Create new block
             //
-            CBlockIndex* pindexPrev = ::ChainActive().Tip();
             bool fPoSCancel = false;
             CScript scriptPubKey = GetScriptForDestination(dest);
             CBlock *pblock;
             std::unique_ptr<CBlockTemplate> pblocktemplate;
 
+            g_stake_minter_stats.nKernelsFound++;
             {
                 LOCK2(cs_main, pwallet->cs_wallet);
+                CStakeLockTimer timer(g_stake_minter_stats.nCoinStakeLockMicros);
+                if (::ChainActive().Tip() != pindexPrev)
+                    continue; // the kernel was found on a stale tip
 
-                pblocktemplate = BlockAssembler(*mempool, Params()).CreateNewBlock(scriptPubKey, pwallet.get(), &fPoSCancel);
+                pblocktemplate = BlockAssembler(*mempool, Params()).CreateNewBlock(scriptPubKey, pwallet.get(), &fPoSCancel, &kernel);
             }
 
             if (!pblocktemplate.get())
@@ -612,6 +809,7 @@ void PoSMiner(std::shared_ptr<CWallet> pwallet, CConnman* connman, CTxMemPool* m
             {
                 {
                     LOCK2(cs_main, pwallet->cs_wallet);
+                    CStakeLockTimer timer(g_stake_minter_stats.nCoinStakeLockMicros);
                     if (!SignBlock(*pblock, *pwallet))
                     {
                         LogPrintf("PoSMiner(): failed to sign PoS block");
@@ -619,7 +817,12 @@ void PoSMiner(std::shared_ptr<CWallet> pwallet, CConnman* connman, CTxMemPool* m
                     }
                 }
                 LogPrintf("CPUMiner : proof-of-stake block found %s\n", pblock->GetHash().ToString());
-                ProcessBlockFound(pblock, Params());
+                if (ProcessBlockFound(pblock, Params())) {
+                    const uint64_t nBroadcastMicros = GetTimeMicros() - nFoundTime;
+                    g_stake_minter_stats.nBlocksBroadcast++;
+                    g_stake_minter_stats.nBroadcastMicros += nBroadcastMicros;
+                    g_stake_minter_stats.nLastBroadcastMicros = nBroadcastMicros;
+                }
                 reservedest.KeepDestination();
                 // Rest for ~3 minutes after successful block to preserve close quick
                 if (!connman->interruptNet.sleep_for(std::chrono::seconds(60 + GetRand(4))))
@@ -660,9 +863,24 @@ void static ThreadStakeMinter(std::shared_ptr<CWallet> pwallet, CConnman* connma
     LogPrintf("ThreadStakeMinter exiting\n");
 }
 
+// sumcoin: stake kernel search worker
+static void ThreadStakeKernelSearch(int worker_num)
+{
+    util::ThreadRename(strprintf("stakesearch.%i", worker_num));
+    stakekernelqueue.Thread();
+}
+
 // sumcoin: stake minter
 void MintStake(boost::thread_group& threadGroup, std::shared_ptr<CWallet> pwallet, CConnman* connman, CTxMemPool* mempool)
 {
+    nStakeThreads = gArgs.GetArg("-stakethreads", DEFAULT_STAKE_THREADS);
+    if (nStakeThreads <= 0)
+        nStakeThreads = GetNumCores();
+    LogPrintf("Stake kernel search uses %d threads\n", nStakeThreads);
+    // The minter thread itself is the last worker
+    for (int i = 0; i < nStakeThreads - 1; ++i)
+        threadGroup.create_thread([i]() { return ThreadStakeKernelSearch(i); });
+
     // sumcoin: mint proof-of-stake blocks in the background
     threadGroup.create_thread(boost::bind(&ThreadStakeMinter, pwallet, connman, mempool));
 }
@@ -11,6 +11,7 @@
 #include <txmempool.h>
 #include <validation.h>
 #include <node/context.h>
+#include <atomic>
 #include <memory>
 #include <stdint.h>
 
@@ -19,10 +20,44 @@
 
 extern int64_t nLastCoinStakeSearchInterval;
 
+/**
+ * Counters of the proof-of-stake minter, updated by the minter and the stake
+ * kernel search threads without taking any lock. Totals are since startup;
+ * a tick is one kernel search of the minter loop.
+ */
+struct CStakeMinterStats
+{
+    std::atomic<uint64_t> nTicks{0};
+    std::atomic<uint64_t> nEligible{0};       // stake candidates prepared
+    std::atomic<uint64_t> nScanned{0};        // candidates whose kernels were hashed
+    std::atomic<uint64_t> nKernelsHashed{0};
+    std::atomic<uint64_t> nSearchMicros{0};   // time hashing kernels
+    std::atomic<uint64_t> nLastEligible{0};
+    std::atomic<uint64_t> nLastScanned{0};
+    // Coinstake timestamps searched and seconds passed between searches;
+    // less searched than passed means timestamps were never tried
+    std::atomic<uint64_t> nWindowSearched{0};
+    std::atomic<uint64_t> nWindowElapsed{0};
+    std::atomic<uint64_t> nDiskReads{0};      // kernel prevouts read from the block files
+    std::atomic<uint64_t> nLastDiskReads{0};
+    // Time holding cs_main and cs_wallet to prepare the search, and to build
+    // the coinstake and block of a kernel found
+    std::atomic<uint64_t> nPrepareLockMicros{0};
+    std::atomic<uint64_t> nCoinStakeLockMicros{0};
+    std::atomic<uint64_t> nMaxLockMicros{0};
+    std::atomic<uint64_t> nKernelsFound{0};
+    std::atomic<uint64_t> nBlocksBroadcast{0};
+    std::atomic<uint64_t> nBroadcastMicros{0}; // from kernel found to block processed
+    std::atomic<uint64_t> nLastBroadcastMicros{0};
+};
+
+extern CStakeMinterStats g_stake_minter_stats;
+
 class CBlockIndex;
 class CChainParams;
 class CScript;
 class CWallet;
+struct CStakeKernel;
 
 namespace Consensus { struct Params; };
 
@@ -161,7 +196,7 @@ public:
     explicit BlockAssembler(const CTxMemPool& mempool, const CChainParams& params, const Options& options);
 
     /** Construct a new block template with coinbase to scriptPubKeyIn */
-    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet=nullptr, bool* pfPoSCancel=nullptr);
+    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet=nullptr, bool* pfPoSCancel=nullptr, const CStakeKernel* pkernel=nullptr);
 
     static Optional<int64_t> m_last_block_num_txs;
     static Optional<int64_t> m_last_block_weight;
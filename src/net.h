@@ -91,6 +91,8 @@ static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
 /** sumcoin: Number of consecutive PoS headers are allowed from a single peer. Used to prevent out of memory attack. */
 static const int32_t MAX_CONSECUTIVE_POS_HEADERS = 10000000;
+/** sumcoin: PoS temperature of a peer sending a proof-of-stake block rejected after the checks done in memory, or reusing a stake */
+static const int32_t POS_BLOCK_REJECT_TEMPERATURE = 100;
 
 // const unsigned int POW_HEADER_COOLING = 70;  - defined in protocol.cpp, so that it is visible to other files
 typedef int64_t NodeId;
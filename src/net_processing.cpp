@@ -3092,6 +3092,20 @@ bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRec
                     return error("this block does not connect to any valid known blocks");
                 }
             }
+
+            // sumcoin: a proof-of-stake block failing the checks done in
+            // memory does not wait for its parent, and costs its sender no
+            // more than a header
+            const CBlockIndex* pindexKnown = LookupBlockIndex(hash2);
+            if (pblock2->IsProofOfStake() && !(pindexKnown && (pindexKnown->nStatus & BLOCK_HAVE_DATA))) {
+                BlockValidationState state;
+                bool fDuplicate = false;
+                if (!PreCheckProofOfStake(*pblock2, state, fDuplicate)) {
+                    MarkBlockAsReceived(hash2);
+                    MaybePunishNodeForBlock(pfrom->GetId(), state, /*via_compact_block=*/ false, "invalid proof-of-stake block");
+                    return error("%s: PreCheckProofOfStake FAILED (%s)", __func__, state.ToString());
+                }
+            }
             // sumcoin: store in memory until we can connect it to some chain
             WaitElement we; we.pblock = pblock2; we.time = nTimeNow;
             mapBlocksWait[headerPrev] = we;
@@ -3164,18 +3178,20 @@ bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRec
 
             bool fNewBlock = false;
             bool fPoSDuplicate = false;
-            ProcessNewBlock(chainparams, pblock, forceProcessing, &fNewBlock, &pindexLastAccepted, &fPoSDuplicate);
+            const bool fAccepted = ProcessNewBlock(chainparams, pblock, forceProcessing, &fNewBlock, &pindexLastAccepted, &fPoSDuplicate);
             if (fNewBlock) {
                 pfrom->nLastBlockTime = GetTime();
             } else {
                 LOCK(cs_main);
                 mapBlockSource.erase(pblock->GetHash());
             }
-            if (fPoSDuplicate)
+            // sumcoin: a proof-of-stake block rejected by ProcessNewBlock may
+            // have cost the lookup of its kernel on disk
+            if (fPoSDuplicate || (!fAccepted && pblock->IsProofOfStake()))
             {
                 LOCK(cs_main);
                 int32_t& nPoSTemperature = mapPoSTemperature[pfrom->addr];
-                nPoSTemperature += 100;
+                nPoSTemperature += POS_BLOCK_REJECT_TEMPERATURE;
             }
         }
         return true;
@@ -0,0 +1,331 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockindexsnapshot.h>
+
+#include <chain.h>
+#include <clientversion.h>
+#include <hash.h>
+#include <kernel.h>
+#include <logging.h>
+#include <pow.h>
+#include <serialize.h>
+#include <streams.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const unsigned char SNAPSHOT_MAGIC[4] = {'s', 'b', 'i', 'x'};
+
+//! A block index entry as stored in the database, with its hash and the stake
+//! modifier checksum that is otherwise computed again at every start
+struct SnapshotEntry {
+    uint256 hash;
+    uint256 hashPrev;
+    int32_t nHeight{0};
+    int32_t nFile{0};
+    uint32_t nDataPos{0};
+    uint32_t nUndoPos{0};
+    uint32_t nTx{0};
+    uint32_t nStatus{0};
+    int32_t nVersion{0};
+    uint256 hashMerkleRoot;
+    uint32_t nTime{0};
+    uint32_t nBits{0};
+    uint32_t nNonce{0};
+    int64_t nMint{0};
+    int64_t nMoneySupply{0};
+    uint32_t nFlags{0};
+    uint64_t nStakeModifier{0};
+    uint32_t nStakeModifierChecksum{0};
+    COutPoint prevoutStake;
+    uint32_t nStakeTime{0};
+    uint256 hashProofOfStake;
+
+    SnapshotEntry() = default;
+
+    explicit SnapshotEntry(const CBlockIndex& index)
+        : hash(index.GetBlockHash()), hashPrev(index.pprev ? index.pprev->GetBlockHash() : uint256()),
+          nHeight(index.nHeight), nFile(index.nFile), nDataPos(index.nDataPos), nUndoPos(index.nUndoPos),
+          nTx(index.nTx), nStatus(index.nStatus), nVersion(index.nVersion), hashMerkleRoot(index.hashMerkleRoot),
+          nTime(index.nTime), nBits(index.nBits), nNonce(index.nNonce), nMint(index.nMint),
+          nMoneySupply(index.nMoneySupply), nFlags(index.nFlags), nStakeModifier(index.nStakeModifier),
+          nStakeModifierChecksum(index.nStakeModifierChecksum), prevoutStake(index.prevoutStake),
+          nStakeTime(index.nStakeTime), hashProofOfStake(index.hashProofOfStake) {}
+
+    void CopyTo(CBlockIndex& index) const
+    {
+        index.nHeight = nHeight;
+        index.nFile = nFile;
+        index.nDataPos = nDataPos;
+        index.nUndoPos = nUndoPos;
+        index.nTx = nTx;
+        index.nStatus = nStatus;
+        index.nVersion = nVersion;
+        index.hashMerkleRoot = hashMerkleRoot;
+        index.nTime = nTime;
+        index.nBits = nBits;
+        index.nNonce = nNonce;
+        index.nMint = nMint;
+        index.nMoneySupply = nMoneySupply;
+        index.nFlags = nFlags;
+        index.nStakeModifier = nStakeModifier;
+        index.nStakeModifierChecksum = nStakeModifierChecksum;
+        index.prevoutStake = prevoutStake;
+        index.nStakeTime = nStakeTime;
+        index.hashProofOfStake = hashProofOfStake;
+    }
+
+    // Fixed width fields only, so that every entry has the same size
+    SERIALIZE_METHODS(SnapshotEntry, obj)
+    {
+        READWRITE(obj.hash, obj.hashPrev, obj.nHeight, obj.nFile, obj.nDataPos, obj.nUndoPos, obj.nTx, obj.nStatus);
+        READWRITE(obj.nVersion, obj.hashMerkleRoot, obj.nTime, obj.nBits, obj.nNonce);
+        READWRITE(obj.nMint, obj.nMoneySupply, obj.nFlags, obj.nStakeModifier, obj.nStakeModifierChecksum);
+        READWRITE(obj.prevoutStake, obj.nStakeTime, obj.hashProofOfStake);
+    }
+};
+
+const size_t SNAPSHOT_HEADER_SIZE = sizeof(SNAPSHOT_MAGIC) + sizeof(uint32_t) + sizeof(uint64_t);
+const size_t SNAPSHOT_ENTRY_SIZE = GetSerializeSize(SnapshotEntry(), CLIENT_VERSION);
+
+//! Reads the entries of the snapshot in place
+class SnapshotReader
+{
+    const unsigned char* m_data;
+    size_t m_size;
+    size_t m_pos{0};
+
+public:
+    SnapshotReader(const unsigned char* data, size_t size) : m_data(data), m_size(size) {}
+
+    int GetType() const { return SER_DISK; }
+    int GetVersion() const { return CLIENT_VERSION; }
+
+    void read(char* dst, size_t n)
+    {
+        if (n > m_size - m_pos)
+            throw std::ios_base::failure("SnapshotReader::read(): end of data");
+        memcpy(dst, m_data + m_pos, n);
+        m_pos += n;
+    }
+
+    template <typename T>
+    SnapshotReader& operator>>(T&& obj)
+    {
+        ::Unserialize(*this, obj);
+        return *this;
+    }
+};
+
+//! The snapshot file mapped read-only, or read into memory where files are
+//! not mapped
+class MappedSnapshot
+{
+    const unsigned char* m_data{nullptr};
+    size_t m_size{0};
+#ifdef WIN32
+    std::vector<unsigned char> m_buffer;
+#endif
+
+public:
+    explicit MappedSnapshot(const fs::path& path)
+    {
+#ifndef WIN32
+        int fd = open(path.string().c_str(), O_RDONLY);
+        if (fd == -1)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                posix_madvise(addr, st.st_size, POSIX_MADV_SEQUENTIAL);
+                m_data = static_cast<const unsigned char*>(addr);
+                m_size = st.st_size;
+            }
+        }
+        close(fd);
+#else
+        FILE* file = fsbridge::fopen(path, "rb");
+        if (!file)
+            return;
+        unsigned char buf[65536];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), file)) > 0)
+            m_buffer.insert(m_buffer.end(), buf, buf + n);
+        fclose(file);
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#endif
+    }
+
+    ~MappedSnapshot()
+    {
+#ifndef WIN32
+        if (m_data)
+            munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+    }
+
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    const unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
+
+// The entries are verified as when they were accepted: the header hash they
+// are indexed by, the proof of work, and the stake modifier checksum from that
+// of the previous block, which is the checksum stored in its own entry
+bool VerifyEntries(const std::vector<CBlockIndex*>& vIndex, const Consensus::Params& consensusParams)
+{
+    std::atomic<bool> fValid{true};
+    auto verify = [&](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd && fValid; i++) {
+            const CBlockIndex* pindex = vIndex[i];
+            if (pindex->GetBlockHeader().GetHash() != pindex->GetBlockHash() ||
+                (pindex->IsProofOfWork() && !CheckProofOfWork(pindex->GetBlockHash(), pindex->nBits, consensusParams)) ||
+                GetStakeModifierChecksum(pindex) != pindex->nStakeModifierChecksum) {
+                LogPrintf("%s: invalid block index entry %s\n", __func__, pindex->ToString());
+                fValid = false;
+            }
+        }
+    };
+
+    const size_t nThreads = std::max(1, std::min(GetNumCores(), 16));
+    const size_t nChunk = (vIndex.size() + nThreads - 1) / nThreads;
+    std::vector<std::thread> vThreads;
+    for (size_t n = 1; n < nThreads && n * nChunk < vIndex.size(); n++)
+        vThreads.emplace_back(verify, n * nChunk, std::min(vIndex.size(), (n + 1) * nChunk));
+    verify(0, std::min(vIndex.size(), nChunk));
+    for (std::thread& thread : vThreads)
+        thread.join();
+    return fValid;
+}
+
+} // namespace
+
+fs::path GetBlockIndexSnapshotPath()
+{
+    return GetDataDir() / "blockindex.dat";
+}
+
+bool WriteBlockIndexSnapshot(const BlockMap& block_index, CBlockTreeDB& blocktree)
+{
+    int64_t nStart = GetTimeMillis();
+    const fs::path path = GetBlockIndexSnapshotPath();
+    const fs::path pathNew = GetDataDir() / "blockindex.dat.new";
+
+    try {
+        FILE* filestr = fsbridge::fopen(pathNew, "wb");
+        if (!filestr)
+            return false;
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        CHashWriter hasher(SER_DISK, CLIENT_VERSION);
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+
+        ss.write((const char*)SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        ss << BLOCK_INDEX_SNAPSHOT_VERSION << (uint64_t)block_index.size();
+        for (const BlockMap::value_type& entry : block_index) {
+            ss << SnapshotEntry(*entry.second);
+            if (ss.size() >= (1 << 20)) {
+                file.write(ss.data(), ss.size());
+                hasher.write(ss.data(), ss.size());
+                ss.clear();
+            }
+        }
+        file.write(ss.data(), ss.size());
+        hasher.write(ss.data(), ss.size());
+
+        const uint256 hashSnapshot = hasher.GetHash();
+        file << hashSnapshot;
+        if (!FileCommit(file.Get()))
+            throw std::runtime_error("FileCommit failed");
+        file.fclose();
+        if (!RenameOver(pathNew, path))
+            throw std::runtime_error("RenameOver failed");
+
+        // The database points to the snapshot only once it is complete on disk
+        if (!blocktree.WriteBlockIndexSnapshotHash(hashSnapshot))
+            throw std::runtime_error("WriteBlockIndexSnapshotHash failed");
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to write the block index snapshot: %s\n", e.what());
+        return false;
+    }
+    LogPrintf("Wrote %u block index entries to %s in %dms\n", block_index.size(), path.string(), GetTimeMillis() - nStart);
+    return true;
+}
+
+bool LoadBlockIndexSnapshot(const Consensus::Params& consensusParams, CBlockTreeDB& blocktree, bool fUse, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+{
+    uint256 hashSnapshot;
+    if (!blocktree.ReadBlockIndexSnapshotHash(hashSnapshot))
+        return false;
+    // Whether or not the snapshot is read, the database changes from now on
+    if (!blocktree.EraseBlockIndexSnapshotHash())
+        return error("%s: failed to erase the snapshot checksum", __func__);
+    if (!fUse)
+        return false;
+
+    int64_t nStart = GetTimeMillis();
+    const fs::path path = GetBlockIndexSnapshotPath();
+    MappedSnapshot snapshot(path);
+    const size_t nTrailer = sizeof(uint256);
+    if (snapshot.size() < SNAPSHOT_HEADER_SIZE + nTrailer || (snapshot.size() - SNAPSHOT_HEADER_SIZE - nTrailer) % SNAPSHOT_ENTRY_SIZE != 0) {
+        LogPrintf("Block index snapshot %s is missing or truncated, reading the block tree database\n", path.string());
+        return false;
+    }
+    const size_t nBody = snapshot.size() - nTrailer;
+    if (Hash(snapshot.data(), snapshot.data() + nBody) != hashSnapshot || memcmp(snapshot.data() + nBody, hashSnapshot.begin(), nTrailer) != 0) {
+        LogPrintf("Block index snapshot %s does not match the block tree database, reading the database\n", path.string());
+        return false;
+    }
+
+    try {
+        SnapshotReader reader(snapshot.data(), nBody);
+        unsigned char magic[sizeof(SNAPSHOT_MAGIC)];
+        uint32_t nVersion;
+        uint64_t nEntries;
+        reader.read((char*)magic, sizeof(magic));
+        reader >> nVersion >> nEntries;
+        if (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 || nVersion != BLOCK_INDEX_SNAPSHOT_VERSION || nEntries != (nBody - SNAPSHOT_HEADER_SIZE) / SNAPSHOT_ENTRY_SIZE) {
+            LogPrintf("Block index snapshot %s has another format, reading the block tree database\n", path.string());
+            return false;
+        }
+
+        std::vector<CBlockIndex*> vIndex;
+        vIndex.reserve(nEntries);
+        SnapshotEntry entry;
+        for (uint64_t n = 0; n < nEntries; n++) {
+            reader >> entry;
+            CBlockIndex* pindexNew = insertBlockIndex(entry.hash);
+            pindexNew->pprev = insertBlockIndex(entry.hashPrev);
+            entry.CopyTo(*pindexNew);
+            vIndex.push_back(pindexNew);
+        }
+        if (!VerifyEntries(vIndex, consensusParams))
+            return false;
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to read the block index snapshot: %s\n", e.what());
+        return false;
+    }
+    LogPrintf("Loaded the block index from %s in %dms\n", path.string(), GetTimeMillis() - nStart);
+    return true;
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKINDEXSNAPSHOT_H
+#define BITCOIN_NODE_BLOCKINDEXSNAPSHOT_H
+
+#include <fs.h>
+#include <uint256.h>
+
+#include <functional>
+#include <unordered_map>
+
+struct BlockHasher;
+class CBlockIndex;
+class CBlockTreeDB;
+namespace Consensus {
+struct Params;
+} // namespace Consensus
+
+//! -blockindexsnapshot default
+static const bool DEFAULT_BLOCK_INDEX_SNAPSHOT = false;
+//! Version of the snapshot format, a snapshot of another version is not read
+static const uint32_t BLOCK_INDEX_SNAPSHOT_VERSION = 1;
+
+/**
+ * sumcoin: the block index is written at a clean shutdown to a flat file of
+ * fixed size entries, mapped at the next start instead of iterating and
+ * decoding the block tree database. The database keeps the checksum of the
+ * snapshot it matches, erased as soon as the database is loaded, so that a
+ * snapshot is never read once the database has changed after it.
+ */
+fs::path GetBlockIndexSnapshotPath();
+
+//! Write the snapshot of a block index flushed to the database
+bool WriteBlockIndexSnapshot(const std::unordered_map<uint256, CBlockIndex*, BlockHasher>& block_index, CBlockTreeDB& blocktree);
+
+/**
+ * Load the block index from the snapshot when fUse and it matches the
+ * database. The header hashes, proofs of work and stake modifier checksums
+ * of the entries are verified on parallel threads. When false is returned,
+ * the database must be read instead, after clearing the entries inserted.
+ */
+bool LoadBlockIndexSnapshot(const Consensus::Params& consensusParams, CBlockTreeDB& blocktree, bool fUse, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+
+#endif // BITCOIN_NODE_BLOCKINDEXSNAPSHOT_H
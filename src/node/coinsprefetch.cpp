@@ -0,0 +1,119 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/coinsprefetch.h>
+
+#include <chain.h>
+#include <primitives/block.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <util/threadnames.h>
+
+#include <set>
+
+CCoinsPrefetcher g_coins_prefetcher;
+
+void CCoinsPrefetcher::Add(const CBlock& block, const CBlockIndex* pindex, CCoinsViewDB& db)
+{
+    // Coins created in the block itself are not in the database
+    std::set<uint256> setTxids;
+    for (const CTransactionRef& tx : block.vtx)
+        setTxids.insert(tx->GetHash());
+
+    Job job;
+    job.pdb = &db;
+    for (const CTransactionRef& tx : block.vtx) {
+        if (tx->IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (!setTxids.count(txin.prevout.hash))
+                job.vOutpoints.push_back(txin.prevout);
+        }
+    }
+    if (job.vOutpoints.empty())
+        return;
+
+    const Key key(pindex->nHeight, pindex->GetBlockHash());
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        if (m_jobs.size() >= MAX_PREFETCH_BLOCKS || !m_jobs.emplace(key, std::move(job)).second)
+            return;
+        m_queue.push_back(key);
+    }
+    m_cond.notify_one();
+}
+
+void CCoinsPrefetcher::Connect(const CBlockIndex* pindex, CCoinsViewCache& cache, const CCoinsViewDB& db)
+{
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_stats.nBlocksConnected++;
+
+    std::map<Key, Job>::iterator it = m_jobs.find(Key(pindex->nHeight, pindex->GetBlockHash()));
+    if (it != m_jobs.end() && it->second.fRead && it->second.pdb == &db && it->second.nFlushCount == db.GetFlushCount()) {
+        m_stats.nBlocksPrefetched++;
+        for (std::pair<COutPoint, Coin>& coin : it->second.vCoins) {
+            if (cache.WarmCoin(coin.first, std::move(coin.second)))
+                m_stats.nCoinsPrefetched++;
+        }
+    }
+
+    // Blocks of other branches at or below this height will not be connected
+    // next, and would be read again if they are
+    m_jobs.erase(m_jobs.begin(), m_jobs.lower_bound(Key(pindex->nHeight + 1, uint256())));
+}
+
+CCoinsPrefetchStats CCoinsPrefetcher::GetStats()
+{
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    CCoinsPrefetchStats stats = m_stats;
+    stats.nPending = m_jobs.size();
+    return stats;
+}
+
+void CCoinsPrefetcher::Thread()
+{
+    while (true) {
+        Key key;
+        std::vector<COutPoint> vOutpoints;
+        CCoinsViewDB* pdb;
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            while (m_queue.empty())
+                m_cond.wait(lock); // interruption point
+            key = m_queue.front();
+            m_queue.pop_front();
+            std::map<Key, Job>::iterator it = m_jobs.find(key);
+            if (it == m_jobs.end())
+                continue; // connected or forgotten before it was read
+            vOutpoints = it->second.vOutpoints;
+            pdb = it->second.pdb;
+        }
+
+        // The flush count is taken before reading, so that coins read while
+        // the database is being written are discarded
+        const uint64_t nFlushCount = pdb->GetFlushCount();
+        std::vector<std::pair<COutPoint, Coin>> vCoins;
+        vCoins.reserve(vOutpoints.size());
+        for (const COutPoint& outpoint : vOutpoints) {
+            Coin coin;
+            if (pdb->GetCoin(outpoint, coin))
+                vCoins.emplace_back(outpoint, std::move(coin));
+        }
+
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        std::map<Key, Job>::iterator it = m_jobs.find(key);
+        if (it == m_jobs.end())
+            continue;
+        it->second.fRead = true;
+        m_stats.nBlocksRead++;
+        it->second.nFlushCount = nFlushCount;
+        it->second.vCoins = std::move(vCoins);
+    }
+}
+
+void ThreadCoinsPrefetch(int worker_num)
+{
+    util::ThreadRename(strprintf("prefetch.%i", worker_num));
+    g_coins_prefetcher.Thread();
+}
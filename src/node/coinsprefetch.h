@@ -0,0 +1,95 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_COINSPREFETCH_H
+#define BITCOIN_NODE_COINSPREFETCH_H
+
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CBlock;
+class CBlockIndex;
+class CCoinsViewDB;
+
+//! -prefetchthreads default, threads reading the coins of blocks ahead of the tip
+static const int DEFAULT_PREFETCH_THREADS = 2;
+//! Maximum number of prefetch threads
+static const int MAX_PREFETCH_THREADS = 16;
+//! Maximum number of blocks whose coins are held for connection
+static const size_t MAX_PREFETCH_BLOCKS = 1024;
+
+struct CCoinsPrefetchStats
+{
+    uint64_t nBlocksRead{0};       // stored blocks whose coins were read
+    uint64_t nBlocksConnected{0};
+    uint64_t nBlocksPrefetched{0}; // connected with their coins read ahead
+    uint64_t nCoinsPrefetched{0};  // coins of those moved into the cache
+    size_t nPending{0};            // blocks stored whose coins are held or being read
+};
+
+/**
+ * Reads the coins spent by blocks stored ahead of the chain tip from the
+ * coins database on a few threads, while the blocks before them are being
+ * connected. When a block is connected its coins are moved into the coins
+ * cache, so that ConnectBlock finds them in memory.
+ *
+ * Coins are only moved into the cache if the coins database has not been
+ * written since they were read and the cache does not hold them already, in
+ * which case they are what the cache would have read itself.
+ */
+class CCoinsPrefetcher
+{
+public:
+    //! Queue the coins spent by a stored block to be read. Requires cs_main.
+    void Add(const CBlock& block, const CBlockIndex* pindex, CCoinsViewDB& db);
+
+    //! Move the coins read for a block about to be connected into the cache,
+    //! and forget the blocks at or below its height. Requires cs_main.
+    void Connect(const CBlockIndex* pindex, CCoinsViewCache& cache, const CCoinsViewDB& db);
+
+    CCoinsPrefetchStats GetStats();
+
+    //! Worker thread
+    void Thread();
+
+    //! Whether prefetch threads were started
+    bool IsEnabled() const { return m_enabled; }
+    void SetEnabled(bool enabled) { m_enabled = enabled; }
+
+private:
+    typedef std::pair<int, uint256> Key; // height and hash of the block
+
+    struct Job {
+        std::vector<COutPoint> vOutpoints;
+        CCoinsViewDB* pdb{nullptr};
+        bool fRead{false};
+        uint64_t nFlushCount{0}; // flushes of the coins database before the coins were read
+        std::vector<std::pair<COutPoint, Coin>> vCoins;
+    };
+
+    boost::mutex m_mutex;
+    boost::condition_variable m_cond;
+    std::map<Key, Job> m_jobs;
+    std::deque<Key> m_queue; // blocks whose coins are to be read, in order of arrival
+    CCoinsPrefetchStats m_stats;
+    bool m_enabled{false};
+};
+
+//! The prefetcher of the coins of blocks ahead of the tip
+extern CCoinsPrefetcher g_coins_prefetcher;
+
+/** Coins prefetch worker */
+void ThreadCoinsPrefetch(int worker_num);
+
+#endif // BITCOIN_NODE_COINSPREFETCH_H
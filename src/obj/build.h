@@ -0,0 +1 @@
+#define BUILD_SUFFIX 16e2642-dirty
@@ -10,7 +10,6 @@
 #include <primitives/block.h>
 #include <uint256.h>
 
-#include <bignum.h>
 #include <chainparams.h>
 #include <kernel.h>
 
@@ -29,12 +28,8 @@ unsigned int GetNextTargetRequired(const CBlockIndex* pindexLast, bool fProofOfS
     int64_t nActualSpacing = pindexPrev->GetBlockTime() - pindexPrevPrev->GetBlockTime();
 
     // sumcoin: target change every block
-    // sumcoin: retarget with exponential moving toward target spacing
-    CBigNum bnNew;
-    bnNew.SetCompact(pindexPrev->nBits);
+    int64_t nTargetSpacing = 0;
     if (Params().NetworkIDString() != CBaseChainParams::REGTEST) {
-        int64_t nTargetSpacing;
-
         if (fProofOfStake) {
             nTargetSpacing = params.nStakeTargetSpacing;
         } else {
@@ -44,14 +39,46 @@ unsigned int GetNextTargetRequired(const CBlockIndex* pindexLast, bool fProofOfS
                 nTargetSpacing = std::min(params.nTargetSpacingWorkMax, params.nStakeTargetSpacing * (1 + pindexLast->nHeight - pindexPrev->nHeight));
             }
         }
+    }
+
+    return CalculateNextTargetRequired(pindexPrev->nBits, nActualSpacing, nTargetSpacing, params);
+}
 
+unsigned int CalculateNextTargetRequired(unsigned int nBitsPrev, int64_t nActualSpacing, int64_t nTargetSpacing, const Consensus::Params& params)
+{
+    bool fNegative;
+    bool fOverflow;
+    arith_uint256 bnPrev;
+    bnPrev.SetCompact(nBitsPrev, &fNegative, &fOverflow);
+
+    // Every nBits on chain is an output of this function, so the previous
+    // target can not overflow 256 bits; clamp it to the limit if it does
+    const arith_uint512 bnPowLimit(UintToArith256(params.powLimit));
+    if (fOverflow)
+        return bnPowLimit.GetCompact();
+
+    // sumcoin: retarget with exponential moving toward target spacing
+    // The target is scaled in 512 bits so the intermediate product can not
+    // overflow; divisions truncate toward zero like the original CBigNum code
+    arith_uint512 bnNew(bnPrev);
+    if (nTargetSpacing > 0) {
         int64_t nInterval = params.nTargetTimespan / nTargetSpacing;
-        bnNew *= ((nInterval - 1) * nTargetSpacing + nActualSpacing + nActualSpacing);
-        bnNew /= ((nInterval + 1) * nTargetSpacing);
+        int64_t nNumerator = (nInterval - 1) * nTargetSpacing + nActualSpacing + nActualSpacing;
+        int64_t nDenominator = (nInterval + 1) * nTargetSpacing;
+        if (nNumerator < 0) {
+            fNegative = !fNegative;
+            nNumerator = -nNumerator;
         }
+        bnNew *= arith_uint512(nNumerator);
+        bnNew /= arith_uint512(nDenominator);
+    }
+
+    // A negative target is never above the limit and keeps its sign
+    if (fNegative)
+        return bnNew.GetCompact(true);
 
-    if (bnNew > CBigNum(params.powLimit))
-        bnNew = CBigNum(params.powLimit);
+    if (bnNew > bnPowLimit)
+        bnNew = bnPowLimit;
 
     return bnNew.GetCompact();
 }
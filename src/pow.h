@@ -15,6 +15,8 @@ class CBlockIndex;
 class uint256;
 
 unsigned int GetNextTargetRequired(const CBlockIndex* pindexLast, bool fProofOfStake, const Consensus::Params& params);
+/** Retarget from the previous target given the actual and target spacing; a zero target spacing keeps the previous target */
+unsigned int CalculateNextTargetRequired(unsigned int nBitsPrev, int64_t nActualSpacing, int64_t nTargetSpacing, const Consensus::Params& params);
 
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
 bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&);
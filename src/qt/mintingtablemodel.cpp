@@ -65,156 +65,54 @@ public:
     QList<KernelRecord> cachedWallet;
 
     /* Query entire wallet anew from core.
+       The wallet keeps the mintable outputs up to date, so this is a copy.
      */
     void refreshWallet()
     {
         cachedWallet.clear();
-        const auto& vwtx = walletModel->wallet().getWalletTxs();
-        for(const auto& wtx : vwtx) {
-            std::vector<KernelRecord> txList = KernelRecord::decomposeOutput(walletModel->wallet(), wtx);
-
-            int numBlocks;
-            interfaces::WalletTxStatus status;
-            interfaces::WalletOrderForm orderForm;
-            bool inMempool;
-            walletModel->wallet().getWalletTxDetails(wtx.tx->GetHash(), status, orderForm, inMempool, numBlocks);
-
-            if(KernelRecord::showTransaction(wtx.is_coinbase, status.depth_in_main_chain))
-                for(const KernelRecord& kr : txList) {
-                    if(!kr.spent) {
-                        cachedWallet.append(kr);
-                    }
-                }
-        }
+        for (const KernelRecord& kr : walletModel->wallet().getMintingRecords())
+            cachedWallet.append(kr);
     }
 
     /* Update our model of the wallet incrementally, to synchronize our model of the wallet
        with that of the core.
 
-       Call with transaction that was added, removed or changed.
+       Call with transaction that was added, removed or changed. The wallet
+       notifies the transactions it spends along with it.
      */
     void updateWallet(const uint256 &hash, int status)
     {
         LogPrintf("minting updateWallet %s %i\n", hash.ToString(), status);
-        {
-            // Find transaction in wallet
-            auto wtx = walletModel->wallet().getWalletTx(hash);
-            bool inWallet = wtx.tx ? true : false;
-
-            // Find bounds of this transaction in model
-            QList<KernelRecord>::iterator lower = qLowerBound(
-                cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
-            QList<KernelRecord>::iterator upper = qUpperBound(
-                cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
-            int lowerIndex = (lower - cachedWallet.begin());
-            int upperIndex = (upper - cachedWallet.begin());
-            bool inModel = (lower != upper);
-
-            // Determine whether to show transaction or not
-            bool showTransaction = false;
-            if (inWallet) {
-                int numBlocks;
-                interfaces::WalletTxStatus status;
-                interfaces::WalletOrderForm orderForm;
-                bool inMempool;
-                walletModel->wallet().getWalletTxDetails(wtx.tx->GetHash(), status, orderForm, inMempool, numBlocks);
-
-                showTransaction = KernelRecord::showTransaction(wtx.is_coinbase, status.depth_in_main_chain);
-            }
-
-            if(status == CT_UPDATED)
-            {
-                if(showTransaction && !inModel)
-                    status = CT_NEW; /* Not in model, but want to show, treat as new */
-                if(!showTransaction && inModel)
-                    status = CT_DELETED; /* In model, but want to hide, treat as deleted */
-            }
-
-            LogPrintf("   inWallet=%i inModel=%i Index=%i-%i showTransaction=%i derivedStatus=%i\n",
-                     inWallet, inModel, lowerIndex, upperIndex, showTransaction, status);
 
-            switch(status)
-            {
-            case CT_NEW:
-                if(inModel)
-                {
-                    LogPrintf("Warning: updateWallet: Got CT_NEW, but transaction is already in model\n");
-                    break;
-                }
-                if(!inWallet)
-                {
-                    LogPrintf("Warning: updateWallet: Got CT_NEW, but transaction is not in wallet\n");
-                    break;
-                }
-                if(showTransaction)
-                {
-                    // Added -- insert at the right position
-                    std::vector<KernelRecord> toInsert =
-                            KernelRecord::decomposeOutput(walletModel->wallet(), wtx);
-                    if(toInsert.size() != 0) /* only if something to insert */
-                    {
-                        parent->beginInsertRows(QModelIndex(), lowerIndex, lowerIndex+toInsert.size()-1);
-                        int insert_idx = lowerIndex;
-                        for (const KernelRecord &rec : toInsert)
-                        {
-                            if(!rec.spent)
-                            {
-                                cachedWallet.insert(insert_idx, rec);
-                                insert_idx += 1;
-                            }
-                        }
-                        parent->endInsertRows();
-                    }
-                }
-                break;
-            case CT_DELETED:
-                if(!inModel)
-                {
-                    LogPrintf("Warning: updateWallet: Got CT_DELETED, but transaction is not in model\n");
-                    break;
-                }
-                // Removed -- remove entire transaction from table
-                parent->beginRemoveRows(QModelIndex(), lowerIndex, upperIndex-1);
-                cachedWallet.erase(lower, upper);
-                parent->endRemoveRows();
-                break;
-            case CT_UPDATED:
-                // Updated -- remove spent coins from table
-                std::vector<KernelRecord> toCheck = KernelRecord::decomposeOutput(walletModel->wallet(), wtx);
-                if(!toCheck.empty())
-                {
-                    for(const KernelRecord &rec : toCheck)
-                    {
-                        if(rec.spent)
-                        {
-                            for(int i = lowerIndex; i < upperIndex; i++)
-                            {
-                                if(i>=cachedWallet.size())
-                                {
-                                    LogPrintf("updateWallet: cachedWallet is smaller than expected, access item %d not in size %d\n", i, cachedWallet.size());
-                                    break;
-                                }
-                                KernelRecord cachedRec = cachedWallet.at(i);
-                                if((rec.address == cachedRec.address)
-                                   && (rec.nValue == cachedRec.nValue)
-                                   && (rec.idx == cachedRec.idx))
-                                {
-                                    if(i>=cachedWallet.size())
-                                    {
-                                        LogPrintf("updateWallet: cachedWallet is smaller than expected, remove item %d not in size %d\n", i, cachedWallet.size());
-                                        break;
-                                    }
-                                    parent->beginRemoveRows(QModelIndex(), i, i);
-                                    cachedWallet.removeAt(i);
-                                    parent->endRemoveRows();
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                }
-                break;
-            }
+        // Mintable outputs of this transaction in wallet
+        std::vector<KernelRecord> records = walletModel->wallet().getMintingRecords(hash);
+
+        // Find bounds of this transaction in model
+        QList<KernelRecord>::iterator lower = qLowerBound(
+            cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
+        QList<KernelRecord>::iterator upper = qUpperBound(
+            cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
+        int lowerIndex = (lower - cachedWallet.begin());
+        int upperIndex = (upper - cachedWallet.begin());
+
+        // Unchanged outputs keep their rows
+        bool fChanged = (upperIndex - lowerIndex) != (int)records.size();
+        for (int i = lowerIndex; i < upperIndex && !fChanged; i++)
+            fChanged = cachedWallet.at(i).idx != records[i - lowerIndex].idx;
+        if (!fChanged)
+            return;
+
+        if (lowerIndex != upperIndex) {
+            parent->beginRemoveRows(QModelIndex(), lowerIndex, upperIndex-1);
+            cachedWallet.erase(lower, upper);
+            parent->endRemoveRows();
+        }
+        if (!records.empty()) {
+            parent->beginInsertRows(QModelIndex(), lowerIndex, lowerIndex+records.size()-1);
+            int insert_idx = lowerIndex;
+            for (const KernelRecord &rec : records)
+                cachedWallet.insert(insert_idx++, rec);
+            parent->endInsertRows();
         }
     }
 
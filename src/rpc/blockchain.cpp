@@ -14,6 +14,7 @@
 #include <core_io.h>
 #include <hash.h>
 #include <index/blockfilterindex.h>
+#include <node/coinsprefetch.h>
 #include <node/coinstats.h>
 #include <node/context.h>
 #include <node/utxo_snapshot.h>
@@ -728,9 +729,6 @@ UniValue getblockhashes(const JSONRPCRequest& request)
 
     std::vector<std::pair<uint256, unsigned int>> blockHashes;
 
-    if (fActiveOnly)
-        LOCK(cs_main);
-
     if (!GetTimestampIndex(high, low, fActiveOnly, blockHashes)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
     }
@@ -1360,6 +1358,40 @@ static UniValue getmempoolinfo(const JSONRPCRequest& request)
     return MempoolInfoToJSON(EnsureMemPool());
 }
 
+static UniValue getprefetchinfo(const JSONRPCRequest& request)
+{
+    RPCHelpMan{
+        "getprefetchinfo",
+        "\nReturns statistics of the coins read ahead for blocks stored ahead of the chain tip (see -prefetchthreads).\n",
+        {},
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+            {
+                {RPCResult::Type::BOOL, "enabled", "Whether coins are read ahead"},
+                {RPCResult::Type::NUM, "pending", "Number of stored blocks whose coins are being read or held"},
+                {RPCResult::Type::NUM, "read", "Number of stored blocks whose coins were read since startup"},
+                {RPCResult::Type::NUM, "connected", "Number of blocks connected since startup"},
+                {RPCResult::Type::NUM, "prefetched", "Number of those whose coins were read ahead"},
+                {RPCResult::Type::NUM, "hitrate", "Share of the connected blocks whose coins were read ahead"},
+                {RPCResult::Type::NUM, "coins", "Number of coins read ahead and moved into the coins cache"},
+            }},
+        RPCExamples{
+            HelpExampleCli("getprefetchinfo", "") + HelpExampleRpc("getprefetchinfo", "")},
+    }
+        .Check(request);
+
+    const CCoinsPrefetchStats stats = g_coins_prefetcher.GetStats();
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("enabled", g_coins_prefetcher.IsEnabled());
+    ret.pushKV("pending", (uint64_t)stats.nPending);
+    ret.pushKV("read", stats.nBlocksRead);
+    ret.pushKV("connected", stats.nBlocksConnected);
+    ret.pushKV("prefetched", stats.nBlocksPrefetched);
+    ret.pushKV("hitrate", stats.nBlocksConnected ? (double)stats.nBlocksPrefetched / stats.nBlocksConnected : 0.0);
+    ret.pushKV("coins", stats.nCoinsPrefetched);
+    return ret;
+}
+
 static UniValue preciousblock(const JSONRPCRequest& request)
 {
     RPCHelpMan{
@@ -2307,6 +2339,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"} },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        {"txid"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {} },
+    { "blockchain",         "getprefetchinfo",        &getprefetchinfo,        {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
@@ -320,6 +320,68 @@ static UniValue getmininginfo(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue getstakinginfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getstakinginfo",
+                "\nReturns performance counters of the proof-of-stake minter since startup.\n"
+                "A tick is one kernel search of the minter, every -staketimio milliseconds.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "search-interval", "Seconds of coinstake timestamps searched by the last tick"},
+                        {RPCResult::Type::NUM, "ticks", "Number of kernel searches"},
+                        {RPCResult::Type::NUM, "kernels-hashed", "Number of kernel hashes"},
+                        {RPCResult::Type::NUM, "kernels-per-second", "Kernel hashes per second of searching"},
+                        {RPCResult::Type::NUM, "eligible", "Outputs old enough to stake at the last tick"},
+                        {RPCResult::Type::NUM, "scanned", "Outputs whose kernels were hashed at the last tick"},
+                        {RPCResult::Type::NUM, "eligible-per-tick", "Average outputs old enough to stake per tick"},
+                        {RPCResult::Type::NUM, "scanned-per-tick", "Average outputs whose kernels were hashed per tick"},
+                        {RPCResult::Type::NUM, "window-coverage", "Share of the seconds passed between ticks whose coinstake timestamps were searched"},
+                        {RPCResult::Type::NUM, "disk-reads", "Kernel outputs read from the block files at the last tick"},
+                        {RPCResult::Type::NUM, "disk-reads-per-tick", "Average kernel outputs read from the block files per tick"},
+                        {RPCResult::Type::NUM, "prepare-lock-ms", "Milliseconds holding cs_main and cs_wallet to prepare the searches"},
+                        {RPCResult::Type::NUM, "coinstake-lock-ms", "Milliseconds holding cs_main and cs_wallet to create and sign coinstakes and their blocks"},
+                        {RPCResult::Type::NUM, "max-lock-ms", "Longest hold of cs_main and cs_wallet by the minter, in milliseconds"},
+                        {RPCResult::Type::NUM, "kernels-found", "Number of kernels found"},
+                        {RPCResult::Type::NUM, "blocks-broadcast", "Number of minted blocks accepted and relayed"},
+                        {RPCResult::Type::NUM, "broadcast-ms", "Average milliseconds from kernel found to block accepted"},
+                        {RPCResult::Type::NUM, "last-broadcast-ms", "Milliseconds from kernel found to block accepted for the last block"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getstakinginfo", "")
+            + HelpExampleRpc("getstakinginfo", "")
+                },
+            }.Check(request);
+
+    const CStakeMinterStats& stats = g_stake_minter_stats;
+    const uint64_t nTicks = stats.nTicks;
+    const uint64_t nSearchMicros = stats.nSearchMicros;
+    const uint64_t nWindowElapsed = stats.nWindowElapsed;
+    const uint64_t nBlocksBroadcast = stats.nBlocksBroadcast;
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("search-interval",     (int)nLastCoinStakeSearchInterval);
+    obj.pushKV("ticks",               nTicks);
+    obj.pushKV("kernels-hashed",      stats.nKernelsHashed.load());
+    obj.pushKV("kernels-per-second",  nSearchMicros ? stats.nKernelsHashed * 1000000.0 / nSearchMicros : 0.0);
+    obj.pushKV("eligible",            stats.nLastEligible.load());
+    obj.pushKV("scanned",             stats.nLastScanned.load());
+    obj.pushKV("eligible-per-tick",   nTicks ? (double)stats.nEligible / nTicks : 0.0);
+    obj.pushKV("scanned-per-tick",    nTicks ? (double)stats.nScanned / nTicks : 0.0);
+    obj.pushKV("window-coverage",     nWindowElapsed ? (double)stats.nWindowSearched / nWindowElapsed : 1.0);
+    obj.pushKV("disk-reads",          stats.nLastDiskReads.load());
+    obj.pushKV("disk-reads-per-tick", nTicks ? (double)stats.nDiskReads / nTicks : 0.0);
+    obj.pushKV("prepare-lock-ms",     stats.nPrepareLockMicros / 1000.0);
+    obj.pushKV("coinstake-lock-ms",   stats.nCoinStakeLockMicros / 1000.0);
+    obj.pushKV("max-lock-ms",         stats.nMaxLockMicros / 1000.0);
+    obj.pushKV("kernels-found",       stats.nKernelsFound.load());
+    obj.pushKV("blocks-broadcast",    nBlocksBroadcast);
+    obj.pushKV("broadcast-ms",        nBlocksBroadcast ? stats.nBroadcastMicros / 1000.0 / nBlocksBroadcast : 0.0);
+    obj.pushKV("last-broadcast-ms",   stats.nLastBroadcastMicros / 1000.0);
+    return obj;
+}
+
 
 
 // NOTE: Assumes a conclusive result; if result is inconclusive, it must be handled by caller
@@ -880,6 +942,7 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "mining",             "getnetworkhashps",       &getnetworkhashps,       {"nblocks","height"} },
     { "mining",             "getmininginfo",          &getmininginfo,          {} },
+    { "mining",             "getstakinginfo",         &getstakinginfo,         {} },
     { "mining",             "getblocktemplate",       &getblocktemplate,       {"template_request"} },
     { "mining",             "submitblock",            &submitblock,            {"hexdata","dummy"} },
     { "mining",             "submitheader",           &submitheader,           {"hexdata"} },
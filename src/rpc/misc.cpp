@@ -15,6 +15,7 @@
 #include <rpc/util.h>
 #include <scheduler.h>
 #include <script/descriptor.h>
+#include <limits>
 #include <stdint.h>
 #include <tuple>
 #include <util/check.h>
@@ -686,10 +687,121 @@ bool getAddressesFromParams(const UniValue& params, std::vector<std::pair<uint25
     return true;
 }
 
-bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
-    std::pair<CAddressUnspentKey, CAddressUnspentValue> b)
+/** A page of address index results: at most nLimit entries after the cursor key */
+struct AddressIndexPage {
+    bool fPaged{false};
+    size_t nLimit{std::numeric_limits<size_t>::max()};
+    bool fDescending{false};
+    std::vector<unsigned char> cursor;
+};
+
+static const size_t DEFAULT_ADDRESS_PAGE_SIZE = 1000;
+static const size_t MAX_ADDRESS_PAGE_SIZE = 100000;
+
+static AddressIndexPage getPageFromParams(const UniValue& params)
+{
+    AddressIndexPage page;
+    if (!params[0].isObject()) {
+        return page;
+    }
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    UniValue orderValue = find_value(params[0].get_obj(), "order");
+    if (limitValue.isNull() && cursorValue.isNull()) {
+        if (!orderValue.isNull()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Order is only supported with a limit or cursor");
+        }
+        return page;
+    }
+
+    page.fPaged = true;
+    page.nLimit = DEFAULT_ADDRESS_PAGE_SIZE;
+    if (!limitValue.isNull()) {
+        int64_t limit = limitValue.get_int64();
+        if (limit <= 0 || (uint64_t)limit > MAX_ADDRESS_PAGE_SIZE) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Limit is expected to be between 1 and %u", MAX_ADDRESS_PAGE_SIZE));
+        }
+        page.nLimit = limit;
+    }
+    if (!cursorValue.isNull()) {
+        if (!IsHex(cursorValue.get_str())) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        page.cursor = ParseHex(cursorValue.get_str());
+    }
+    if (!orderValue.isNull()) {
+        if (orderValue.get_str() == "desc") {
+            page.fDescending = true;
+        } else if (orderValue.get_str() != "asc") {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Order is expected to be asc or desc");
+        }
+    }
+    return page;
+}
+
+/**
+ * Walk the entries of the addresses in page order, one address after the
+ * other, and pass at most a page of them to the visitor without collecting
+ * them first. With fWholeTx set a page is only cut between transactions.
+ * Returns the cursor of the next page, or null if this is the last one.
+ */
+template <typename Key, typename Value>
+static UniValue walkAddressIndexPage(
+    const std::vector<std::pair<uint256, int>>& addresses, const AddressIndexPage& page, bool fWholeTx,
+    const std::function<bool(const std::pair<uint256, int>&, const std::function<bool(const Key&, const Value&)>&, const Key*)>& iterate,
+    const std::function<void(const Key&, const Value&)>& visitor)
 {
-    return a.second.blockHeight < b.second.blockHeight;
+    Key keyAfter;
+    size_t nFirst = 0;
+    if (!page.cursor.empty()) {
+        try {
+            CDataStream ssCursor(page.cursor, SER_DISK, CLIENT_VERSION);
+            ssCursor >> keyAfter;
+            if (!ssCursor.empty()) {
+                throw std::ios_base::failure("cursor too long");
+            }
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        for (nFirst = 0; nFirst < addresses.size(); nFirst++) {
+            const std::pair<uint256, int>& address = addresses[page.fDescending ? addresses.size() - 1 - nFirst : nFirst];
+            if (address.first == keyAfter.hashBytes && (unsigned int)address.second == keyAfter.type) {
+                break;
+            }
+        }
+        if (nFirst == addresses.size()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor does not belong to the addresses");
+        }
+    }
+
+    size_t nCount = 0;
+    bool fMore = false;
+    Key keyLast;
+    for (size_t i = nFirst; i < addresses.size() && !fMore; i++) {
+        const std::pair<uint256, int>& address = addresses[page.fDescending ? addresses.size() - 1 - i : i];
+        const Key* pkeyAfter = !page.cursor.empty() && i == nFirst ? &keyAfter : nullptr;
+        bool fFound = iterate(address, [&](const Key& key, const Value& value) {
+            if (nCount >= page.nLimit && !(fWholeTx && key.txhash == keyLast.txhash)) {
+                fMore = true;
+                return false;
+            }
+            nCount++;
+            keyLast = key;
+            visitor(key, value);
+            return true;
+        }, pkeyAfter);
+        if (!fFound) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+
+    if (!fMore) {
+        return NullUniValue;
+    }
+    CDataStream ssCursor(SER_DISK, CLIENT_VERSION);
+    ssCursor << keyLast;
+    return HexStr(ssCursor.begin(), ssCursor.end());
 }
 
 bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
@@ -780,6 +892,9 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "      ,...\n"
             "    ],\n"
             "  \"chainInfo\"  (boolean) Include chain info with results\n"
+            "  \"limit\"  (number, optional) Return a page of at most this many outputs, ordered by address, txid and output index (default 1000 when a cursor is given, at most 100000)\n"
+            "  \"cursor\"  (string, optional) The cursor returned with the previous page\n"
+            "  \"order\"  (string, optional, default=asc) The order of a page, asc or desc\n"
             "}\n"
             "\nResult\n"
             "[\n"
@@ -792,6 +907,11 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    \"satoshis\"  (number) The number of satoshis of the output\n"
             "  }\n"
             "]\n"
+            "\nResult (with a limit or cursor)\n"
+            "{\n"
+            "  \"utxos\"  (array) The outputs of the page, as above\n"
+            "  \"cursor\"  (string) The cursor of the next page, null after the last page\n"
+            "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'") + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}"));
 
@@ -809,41 +929,59 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
-
-    for (std::vector<std::pair<uint256, int>>::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    const AddressIndexPage page = getPageFromParams(request.params);
 
     UniValue utxos(UniValue::VARR);
 
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++) {
+    auto pushOutput = [&utxos](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
         UniValue output(UniValue::VOBJ);
         std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
+        if (!getAddressFromIndex(key.type, key.hashBytes, address)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
         }
 
         output.pushKV("address", address);
-        output.pushKV("txid", it->first.txhash.GetHex());
-        output.pushKV("outputIndex", (int)it->first.index);
-        output.pushKV("script", HexStr(it->second.script.begin(), it->second.script.end()));
-        output.pushKV("satoshis", it->second.satoshis);
-        output.pushKV("height", it->second.blockHeight);
+        output.pushKV("txid", key.txhash.GetHex());
+        output.pushKV("outputIndex", (int)key.index);
+        output.pushKV("script", HexStr(value.script.begin(), value.script.end()));
+        output.pushKV("satoshis", value.satoshis);
+        output.pushKV("height", value.blockHeight);
         utxos.push_back(output);
+    };
+
+    // A page is written out as it is read, all outputs are read at once in height order
+    UniValue cursor;
+    if (page.fPaged) {
+        cursor = walkAddressIndexPage<CAddressUnspentKey, CAddressUnspentValue>(
+            addresses, page, false,
+            [&page](const std::pair<uint256, int>& address, const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& visitor, const CAddressUnspentKey* pkeyAfter) {
+                return IterateAddressUnspent(address.first, address.second, visitor, pkeyAfter, page.fDescending);
+            },
+            pushOutput);
+    } else {
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
+
+        if (!GetAddressUnspent(addresses, unspentOutputs)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+
+        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++) {
+            pushOutput(it->first, it->second);
+        }
     }
 
-    if (includeChainInfo) {
+    if (includeChainInfo || page.fPaged) {
         UniValue result(UniValue::VOBJ);
         result.pushKV("utxos", utxos);
+        if (page.fPaged) {
+            result.pushKV("cursor", cursor);
+        }
 
-        LOCK(cs_main);
-        result.pushKV("hash", ::ChainActive().Tip()->GetBlockHash().GetHex());
-        result.pushKV("height", (int)ChainActive().Height());
+        if (includeChainInfo) {
+            LOCK(cs_main);
+            result.pushKV("hash", ::ChainActive().Tip()->GetBlockHash().GetHex());
+            result.pushKV("height", (int)ChainActive().Height());
+        }
         return result;
     } else {
         return utxos;
@@ -866,6 +1004,9 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
             "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
+            "  \"limit\" (number, optional) Return a page of at most this many deltas (default 1000 when a cursor is given, at most 100000)\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page\n"
+            "  \"order\" (string, optional, default=asc) The order of a page, asc or desc by height\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -877,6 +1018,11 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nResult (with a limit or cursor):\n"
+            "{\n"
+            "  \"deltas\"  (array) The deltas of the page, as above\n"
+            "  \"cursor\"  (string) The cursor of the next page, null after the last page\n"
+            "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'") + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}"));
 
@@ -910,36 +1056,44 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
-
-    for (std::vector<std::pair<uint256, int>>::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-    }
+    const AddressIndexPage page = getPageFromParams(request.params);
 
     UniValue deltas(UniValue::VARR);
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount>>::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
+    auto pushDelta = [&deltas](const CAddressIndexKey& key, const CAmount& nValue) {
         std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
+        if (!getAddressFromIndex(key.type, key.hashBytes, address)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
         }
 
         UniValue delta(UniValue::VOBJ);
-        delta.pushKV("satoshis", it->second);
-        delta.pushKV("txid", it->first.txhash.GetHex());
-        delta.pushKV("index", (int)it->first.index);
-        delta.pushKV("blockindex", (int)it->first.txindex);
-        delta.pushKV("height", it->first.blockHeight);
+        delta.pushKV("satoshis", nValue);
+        delta.pushKV("txid", key.txhash.GetHex());
+        delta.pushKV("index", (int)key.index);
+        delta.pushKV("blockindex", (int)key.txindex);
+        delta.pushKV("height", key.blockHeight);
         delta.pushKV("address", address);
         deltas.push_back(delta);
+    };
+
+    UniValue cursor;
+    if (page.fPaged) {
+        cursor = walkAddressIndexPage<CAddressIndexKey, CAmount>(
+            addresses, page, false,
+            [&](const std::pair<uint256, int>& address, const std::function<bool(const CAddressIndexKey&, const CAmount&)>& visitor, const CAddressIndexKey* pkeyAfter) {
+                return IterateAddressIndex(address.first, address.second, visitor, pkeyAfter, page.fDescending, start, end);
+            },
+            pushDelta);
+    } else {
+        std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+
+        if (!GetAddressIndex(addresses, addressIndex, start, end)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+
+        for (std::vector<std::pair<CAddressIndexKey, CAmount>>::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
+            pushDelta(it->first, it->second);
+        }
     }
 
     UniValue result(UniValue::VOBJ);
@@ -964,9 +1118,16 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         endInfo.pushKV("height", end);
 
         result.pushKV("deltas", deltas);
+        if (page.fPaged) {
+            result.pushKV("cursor", cursor);
+        }
         result.pushKV("start", startInfo);
         result.pushKV("end", endInfo);
 
+        return result;
+    } else if (page.fPaged) {
+        result.pushKV("deltas", deltas);
+        result.pushKV("cursor", cursor);
         return result;
     } else {
         return deltas;
@@ -991,6 +1152,9 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
             "{\n"
             "  \"balance\"  (string) The current balance in satoshis\n"
             "  \"received\"  (string) The total number of satoshis received (including change)\n"
+            "  \"txcount\"  (numeric) The number of transactions of each address, summed\n"
+            "  \"firstheight\"  (numeric) The height of the first transaction, -1 if none\n"
+            "  \"lastheight\"  (numeric) The height of the last transaction, -1 if none\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'") + HelpExampleRpc("getaddressbalance", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}"));
@@ -1001,27 +1165,35 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+    CAmount balance = 0;
+    CAmount received = 0;
+    int64_t txCount = 0;
+    int firstHeight = -1;
+    int lastHeight = -1;
 
     for (std::vector<std::pair<uint256, int>>::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+        CAddressBalance addressBalance;
+        if (!GetAddressBalance((*it).first, (*it).second, addressBalance)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-    }
-
-    CAmount balance = 0;
-    CAmount received = 0;
-
-    for (std::vector<std::pair<CAddressIndexKey, CAmount>>::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+        if (addressBalance.IsNull()) {
+            continue;
         }
-        balance += it->second;
+        balance += addressBalance.balance;
+        received += addressBalance.received;
+        txCount += addressBalance.txCount;
+        if (firstHeight < 0 || addressBalance.firstHeight < firstHeight) {
+            firstHeight = addressBalance.firstHeight;
+        }
+        lastHeight = std::max(lastHeight, addressBalance.lastHeight);
     }
 
     UniValue result(UniValue::VOBJ);
     result.pushKV("balance", balance);
     result.pushKV("received", received);
+    result.pushKV("txcount", txCount);
+    result.pushKV("firstheight", firstHeight);
+    result.pushKV("lastheight", lastHeight);
 
     return result;
 }
@@ -1041,12 +1213,20 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return a page of the txids of at most this many address deltas, ordered by address and height (default 1000 when a cursor is given, at most 100000)\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page\n"
+            "  \"order\" (string, optional, default=asc) The order of a page, asc or desc by height\n"
             "}\n"
             "\nResult:\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult (with a limit or cursor):\n"
+            "{\n"
+            "  \"txids\"  (array) The txids of the page, as above\n"
+            "  \"cursor\"  (string) The cursor of the next page, null after the last page\n"
+            "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'") + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}"));
 
@@ -1067,23 +1247,39 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         }
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
-
-    for (std::vector<std::pair<uint256, int>>::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-    }
+    const AddressIndexPage page = getPageFromParams(request.params);
 
     std::set<std::pair<int, std::string>> txids;
     UniValue result(UniValue::VARR);
 
+    if (page.fPaged) {
+        // The entries of a transaction are adjacent, so a page is
+        // deduplicated as it is read and never splits a transaction
+        uint256 txhashLast;
+        UniValue cursor = walkAddressIndexPage<CAddressIndexKey, CAmount>(
+            addresses, page, true,
+            [&](const std::pair<uint256, int>& address, const std::function<bool(const CAddressIndexKey&, const CAmount&)>& visitor, const CAddressIndexKey* pkeyAfter) {
+                return IterateAddressIndex(address.first, address.second, visitor, pkeyAfter, page.fDescending, start, end);
+            },
+            [&](const CAddressIndexKey& key, const CAmount& nValue) {
+                if (result.empty() || key.txhash != txhashLast) {
+                    result.push_back(key.txhash.GetHex());
+                    txhashLast = key.txhash;
+                }
+            });
+
+        UniValue paged(UniValue::VOBJ);
+        paged.pushKV("txids", result);
+        paged.pushKV("cursor", cursor);
+        return paged;
+    }
+
+    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+
+    if (!GetAddressIndex(addresses, addressIndex, start, end)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
     for (std::vector<std::pair<CAddressIndexKey, CAmount>>::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
         int height = it->first.blockHeight;
         std::string txid = it->first.txhash.GetHex();
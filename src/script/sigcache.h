@@ -53,4 +53,7 @@ public:
 
 void InitSignatureCache();
 
+/** Verify an ECDSA signature of a hash, consulting the signature cache and, if store is set, caching it when valid. */
+bool VerifySignatureCached(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& hash, bool store);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
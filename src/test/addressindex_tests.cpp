@@ -0,0 +1,253 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addressindex.h>
+#include <amount.h>
+#include <index/addressindex.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, BasicTestingSetup)
+
+// The address balance as getaddressbalance computed it from the full history
+static CAddressBalance SumAddressIndex(AddressIndex::DB& db, const uint256& addressHash, int type)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+    BOOST_CHECK(db.ReadAddressIndex(addressHash, type, addressIndex));
+
+    CAddressBalance balance;
+    std::set<uint256> txids;
+    for (const std::pair<CAddressIndexKey, CAmount>& entry : addressIndex) {
+        balance.balance += entry.second;
+        if (entry.second > 0)
+            balance.received += entry.second;
+        txids.insert(entry.first.txhash);
+        if (balance.firstHeight < 0)
+            balance.firstHeight = entry.first.blockHeight;
+        balance.lastHeight = entry.first.blockHeight;
+    }
+    balance.txCount = txids.size();
+    return balance;
+}
+
+static void CheckAddressBalance(AddressIndex::DB& db, const uint256& addressHash, int type)
+{
+    const CAddressBalance expected = SumAddressIndex(db, addressHash, type);
+    CAddressBalance balance;
+    BOOST_CHECK_EQUAL(db.ReadAddressBalance(addressHash, type, balance), !expected.IsNull());
+    if (expected.IsNull())
+        return;
+    BOOST_CHECK_EQUAL(balance.balance, expected.balance);
+    BOOST_CHECK_EQUAL(balance.received, expected.received);
+    BOOST_CHECK_EQUAL(balance.txCount, expected.txCount);
+    BOOST_CHECK_EQUAL(balance.firstHeight, expected.firstHeight);
+    BOOST_CHECK_EQUAL(balance.lastHeight, expected.lastHeight);
+}
+
+// The address index entries of a block paying to and spending from a few addresses
+static std::vector<std::pair<CAddressIndexKey, CAmount>> MakeBlockEntries(const std::vector<uint256>& vAddresses, int nHeight)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount>> vEntries;
+    const int nTx = 1 + InsecureRandRange(4);
+    for (int i = 0; i < nTx; i++) {
+        const uint256 txhash = InsecureRand256();
+        const int nEntries = 1 + InsecureRandRange(4);
+        for (int k = 0; k < nEntries; k++) {
+            const uint256& addressHash = vAddresses[InsecureRandRange(vAddresses.size())];
+            const bool fSpending = InsecureRandBool();
+            const CAmount nValue = 1 + InsecureRandRange(100 * COIN);
+            vEntries.push_back(std::make_pair(CAddressIndexKey(1, addressHash, nHeight, i, txhash, k, fSpending), fSpending ? -nValue : nValue));
+        }
+    }
+    return vEntries;
+}
+
+BOOST_AUTO_TEST_CASE(address_balance_connect_disconnect)
+{
+    AddressIndex::DB db(1 << 20, true);
+    std::vector<uint256> vAddresses;
+    for (int i = 0; i < 5; i++)
+        vAddresses.push_back(InsecureRand256());
+
+    // Connect and disconnect blocks at the tip, replaying some of them as a
+    // chainstate reindex does
+    std::vector<std::vector<std::pair<CAddressIndexKey, CAmount>>> vBlocks;
+    for (int i = 0; i < 200; i++) {
+        if (!vBlocks.empty() && InsecureRandRange(3) == 0) {
+            BOOST_CHECK(db.EraseAddressIndex(vBlocks.back()));
+            vBlocks.pop_back();
+        } else {
+            vBlocks.push_back(MakeBlockEntries(vAddresses, vBlocks.size() + 1));
+            BOOST_CHECK(db.WriteAddressIndex(vBlocks.back()));
+        }
+        if (!vBlocks.empty() && InsecureRandRange(10) == 0)
+            BOOST_CHECK(db.WriteAddressIndex(vBlocks[InsecureRandRange(vBlocks.size())]));
+        for (const uint256& addressHash : vAddresses)
+            CheckAddressBalance(db, addressHash, 1);
+    }
+
+    // Every address is gone once all of its blocks are disconnected
+    while (!vBlocks.empty()) {
+        BOOST_CHECK(db.EraseAddressIndex(vBlocks.back()));
+        vBlocks.pop_back();
+    }
+    CAddressBalance balance;
+    for (const uint256& addressHash : vAddresses)
+        BOOST_CHECK(!db.ReadAddressBalance(addressHash, 1, balance));
+}
+
+BOOST_AUTO_TEST_CASE(address_balance_build)
+{
+    AddressIndex::DB db(1 << 20, true);
+    std::vector<uint256> vAddresses;
+    for (int i = 0; i < 20; i++)
+        vAddresses.push_back(InsecureRand256());
+    for (int nHeight = 1; nHeight <= 100; nHeight++)
+        BOOST_CHECK(db.WriteAddressIndex(MakeBlockEntries(vAddresses, nHeight)));
+
+    // Entries moved from the block tree database get their balances summed
+    // from the entries, which matches the balances kept while connecting blocks
+    std::vector<CAddressBalance> vExpected;
+    for (const uint256& addressHash : vAddresses) {
+        vExpected.push_back(SumAddressIndex(db, addressHash, 1));
+        CheckAddressBalance(db, addressHash, 1);
+    }
+    BOOST_CHECK(db.BuildAddressBalances());
+    for (size_t i = 0; i < vAddresses.size(); i++) {
+        CAddressBalance balance;
+        BOOST_CHECK(db.ReadAddressBalance(vAddresses[i], 1, balance));
+        BOOST_CHECK_EQUAL(balance.balance, vExpected[i].balance);
+        BOOST_CHECK_EQUAL(balance.received, vExpected[i].received);
+        BOOST_CHECK_EQUAL(balance.txCount, vExpected[i].txCount);
+        BOOST_CHECK_EQUAL(balance.firstHeight, vExpected[i].firstHeight);
+        BOOST_CHECK_EQUAL(balance.lastHeight, vExpected[i].lastHeight);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(address_index_pages)
+{
+    AddressIndex::DB db(1 << 20, true);
+    std::vector<uint256> vAddresses;
+    for (int i = 0; i < 3; i++)
+        vAddresses.push_back(InsecureRand256());
+    for (int nHeight = 1; nHeight <= 50; nHeight++)
+        BOOST_CHECK(db.WriteAddressIndex(MakeBlockEntries(vAddresses, nHeight)));
+
+    for (const uint256& addressHash : vAddresses) {
+        for (int i = 0; i < 20; i++) {
+            int start = 0;
+            int end = 0;
+            if (InsecureRandBool()) {
+                start = 1 + InsecureRandRange(50);
+                end = start + InsecureRandRange(50);
+            }
+            std::vector<std::pair<CAddressIndexKey, CAmount>> vExpected;
+            BOOST_CHECK(db.ReadAddressIndex(addressHash, 1, vExpected, start, end));
+
+            // Walking in pages after the last key of the previous page, in
+            // either order, visits every entry exactly once
+            const bool fDescending = InsecureRandBool();
+            if (fDescending)
+                std::reverse(vExpected.begin(), vExpected.end());
+            const size_t nLimit = 1 + InsecureRandRange(10);
+            std::vector<std::pair<CAddressIndexKey, CAmount>> vPaged;
+            std::unique_ptr<CAddressIndexKey> pkeyAfter;
+            while (true) {
+                size_t nCount = 0;
+                BOOST_CHECK(db.IterateAddressIndex(addressHash, 1, [&](const CAddressIndexKey& key, CAmount nValue) {
+                    vPaged.push_back(std::make_pair(key, nValue));
+                    return ++nCount < nLimit;
+                }, pkeyAfter.get(), fDescending, start, end));
+                if (nCount < nLimit)
+                    break;
+                pkeyAfter.reset(new CAddressIndexKey(vPaged.back().first));
+            }
+            BOOST_REQUIRE_EQUAL(vPaged.size(), vExpected.size());
+            for (size_t n = 0; n < vPaged.size(); n++) {
+                BOOST_CHECK(vPaged[n].first == vExpected[n].first);
+                BOOST_CHECK_EQUAL(vPaged[n].second, vExpected[n].second);
+            }
+        }
+    }
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> vUnspent;
+    for (int i = 0; i < 30; i++)
+        vUnspent.push_back(std::make_pair(CAddressUnspentKey(1, vAddresses[0], InsecureRand256(), i), CAddressUnspentValue(1 + i, CScript(), i)));
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(vUnspent));
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> vExpected;
+    BOOST_CHECK(db.ReadAddressUnspentIndex(vAddresses[0], 1, vExpected));
+    BOOST_CHECK_EQUAL(vExpected.size(), vUnspent.size());
+    std::vector<CAddressUnspentKey> vDescending;
+    BOOST_CHECK(db.IterateAddressUnspentIndex(vAddresses[0], 1, [&](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+        vDescending.push_back(key);
+        return true;
+    }, &vExpected[20].first, true));
+    BOOST_REQUIRE_EQUAL(vDescending.size(), 20U);
+    for (size_t n = 0; n < vDescending.size(); n++)
+        BOOST_CHECK(vDescending[n] == vExpected[19 - n].first);
+}
+
+BOOST_AUTO_TEST_CASE(address_index_batch)
+{
+    AddressIndex::DB db(1 << 20, true);
+    std::vector<uint256> vAddresses;
+    for (int i = 0; i < 40; i++)
+        vAddresses.push_back(InsecureRand256());
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> vUnspent;
+    for (int nHeight = 1; nHeight <= 100; nHeight++) {
+        const std::vector<std::pair<CAddressIndexKey, CAmount>> vEntries = MakeBlockEntries(vAddresses, nHeight);
+        BOOST_CHECK(db.WriteAddressIndex(vEntries));
+        for (const std::pair<CAddressIndexKey, CAmount>& entry : vEntries) {
+            if (entry.second > 0)
+                vUnspent.push_back(std::make_pair(CAddressUnspentKey(1, entry.first.hashBytes, entry.first.txhash, entry.first.index), CAddressUnspentValue(entry.second, CScript(), nHeight)));
+        }
+    }
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(vUnspent));
+
+    boost::thread_group threadGroup;
+    for (int i = 0; i < 3; i++)
+        threadGroup.create_thread([i]() { return ThreadAddressIndexRead(i); });
+
+    // Reading the addresses at once gives what reading them one at a time
+    // and sorting by height gives
+    std::vector<std::pair<uint256, int>> addresses;
+    std::vector<std::pair<CAddressIndexKey, CAmount>> vExpected;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> vExpectedUnspent;
+    for (const uint256& addressHash : vAddresses) {
+        addresses.emplace_back(addressHash, 1);
+        BOOST_CHECK(db.ReadAddressIndex(addressHash, 1, vExpected, 20, 80));
+        BOOST_CHECK(db.ReadAddressUnspentIndex(addressHash, 1, vExpectedUnspent));
+    }
+    std::stable_sort(vExpected.begin(), vExpected.end(), [](const std::pair<CAddressIndexKey, CAmount>& a, const std::pair<CAddressIndexKey, CAmount>& b) {
+        return std::make_pair(a.first.blockHeight, a.first.txindex) < std::make_pair(b.first.blockHeight, b.first.txindex);
+    });
+    std::stable_sort(vExpectedUnspent.begin(), vExpectedUnspent.end(), [](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& a, const std::pair<CAddressUnspentKey, CAddressUnspentValue>& b) {
+        return a.second.blockHeight < b.second.blockHeight;
+    });
+
+    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+    BOOST_CHECK(db.ReadAddressIndexBatch(addresses, addressIndex, 20, 80));
+    BOOST_REQUIRE_EQUAL(addressIndex.size(), vExpected.size());
+    for (size_t n = 0; n < addressIndex.size(); n++)
+        BOOST_CHECK(addressIndex[n].first == vExpected[n].first);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
+    BOOST_CHECK(db.ReadAddressUnspentIndexBatch(addresses, unspentOutputs));
+    BOOST_REQUIRE_EQUAL(unspentOutputs.size(), vExpectedUnspent.size());
+    for (size_t n = 0; n < unspentOutputs.size(); n++)
+        BOOST_CHECK(unspentOutputs[n].first == vExpectedUnspent[n].first);
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,9 +4,13 @@
 
 #include <attributes.h>
 #include <clientversion.h>
+#include <chain.h>
 #include <coins.h>
+#include <node/coinsprefetch.h>
+#include <primitives/block.h>
 #include <script/standard.h>
 #include <streams.h>
+#include <txdb.h>
 #include <test/util/setup_common.h>
 #include <uint256.h>
 #include <undo.h>
@@ -16,6 +20,7 @@
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
 
 int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out);
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txundo, int nHeight);
@@ -861,4 +866,89 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+static void WaitForPrefetch(CCoinsPrefetcher& prefetcher, uint64_t nBlocksRead)
+{
+    while (prefetcher.GetStats().nBlocksRead < nBlocksRead)
+        UninterruptibleSleep(std::chrono::milliseconds{1});
+}
+
+BOOST_AUTO_TEST_CASE(coins_prefetch)
+{
+    CCoinsViewDB db("coins_prefetch", 1 << 20, true, false);
+
+    // Two coins in the database
+    std::vector<COutPoint> vOutpoints;
+    std::vector<CTxOut> vOuts;
+    CCoinsMap mapCoins;
+    for (int i = 0; i < 3; i++) {
+        vOutpoints.emplace_back(InsecureRand256(), 0);
+        if (i == 2)
+            continue; // not in the database
+        vOuts.emplace_back(InsecureRandRange(1000 * COIN), CScript() << OP_TRUE);
+        CCoinsCacheEntry entry;
+        entry.coin = Coin(vOuts.back(), 1, false, false, 0);
+        entry.flags = CCoinsCacheEntry::DIRTY;
+        mapCoins.emplace(vOutpoints.back(), std::move(entry));
+    }
+    BOOST_CHECK(db.BatchWrite(mapCoins, InsecureRand256()));
+
+    // A block spending them, the missing coin and an output of the block itself
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.emplace_back(1, CScript() << OP_TRUE);
+    CMutableTransaction spend;
+    for (const COutPoint& outpoint : vOutpoints)
+        spend.vin.emplace_back(outpoint);
+    spend.vin.emplace_back(COutPoint(coinbase.GetHash(), 0));
+    spend.vout.emplace_back(1, CScript() << OP_TRUE);
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.vtx.push_back(MakeTransactionRef(spend));
+
+    std::vector<uint256> hashes{InsecureRand256(), InsecureRand256(), InsecureRand256()};
+    std::vector<CBlockIndex> blocks(3);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].nHeight = 10 + i;
+    }
+
+    CCoinsPrefetcher prefetcher;
+    boost::thread thread([&prefetcher] { prefetcher.Thread(); });
+
+    // The coins in the database are moved into the cache on connection
+    prefetcher.Add(block, &blocks[0], db);
+    WaitForPrefetch(prefetcher, 1);
+    CCoinsViewCache cache(&db);
+    prefetcher.Connect(&blocks[0], cache, db);
+    BOOST_CHECK(cache.HaveCoinInCache(vOutpoints[0]));
+    BOOST_CHECK(cache.HaveCoinInCache(vOutpoints[1]));
+    BOOST_CHECK(!cache.HaveCoinInCache(vOutpoints[2]));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 2U);
+    BOOST_CHECK(cache.AccessCoin(vOutpoints[1]).out == vOuts[1]);
+
+    // Not once the database was written after they were read
+    CCoinsViewCache cache2(&db);
+    prefetcher.Add(block, &blocks[1], db);
+    WaitForPrefetch(prefetcher, 2);
+    CCoinsMap mapEmpty;
+    BOOST_CHECK(db.BatchWrite(mapEmpty, InsecureRand256()));
+    prefetcher.Connect(&blocks[1], cache2, db);
+    BOOST_CHECK_EQUAL(cache2.GetCacheSize(), 0U);
+
+    // Blocks at or below a connected height are forgotten
+    prefetcher.Add(block, &blocks[2], db);
+    WaitForPrefetch(prefetcher, 3);
+    BOOST_CHECK_EQUAL(prefetcher.GetStats().nPending, 1U);
+    prefetcher.Connect(&blocks[2], cache2, db);
+    BOOST_CHECK_EQUAL(prefetcher.GetStats().nPending, 0U);
+
+    const CCoinsPrefetchStats stats = prefetcher.GetStats();
+    BOOST_CHECK_EQUAL(stats.nBlocksConnected, 3U);
+    BOOST_CHECK_EQUAL(stats.nBlocksPrefetched, 2U);
+    BOOST_CHECK_EQUAL(stats.nCoinsPrefetched, 2U + 2U);
+
+    thread.interrupt();
+    thread.join();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,552 @@
+// Copyright (c) 2012-2022 The Sumcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <amount.h>
+#include <arith_uint256.h>
+#include <bignum.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/merkle.h>
+#include <consensus/validation.h>
+#include <hash.h>
+#include <key.h>
+#include <kernel.h>
+#include <kernelprevout.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(kernel_tests, BasicTestingSetup)
+
+// The kernel target check as it was computed before fixed-width integers
+static CBigNum ReferenceStakeTarget(unsigned int nBits, int64_t nValueIn, int64_t nTimeWeight)
+{
+    CBigNum bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(nBits);
+    CBigNum bnCoinDayWeight = CBigNum(nValueIn) * nTimeWeight / COIN / (24 * 60 * 60);
+    return bnCoinDayWeight * bnTargetPerCoinDay;
+}
+
+static bool ReferenceStakeKernelTarget(unsigned int nBits, int64_t nValueIn, int64_t nTimeWeight, const uint256& hashProofOfStake)
+{
+    return !(CBigNum(hashProofOfStake) > ReferenceStakeTarget(nBits, nValueIn, nTimeWeight));
+}
+
+// Check both implementations against a hash and the hashes around the exact
+// weighted target, whenever that target is representable as a hash
+static void CheckStakeKernelTargetAgrees(unsigned int nBits, int64_t nValueIn, int64_t nTimeWeight, const uint256& hash)
+{
+    BOOST_CHECK_EQUAL(CheckStakeKernelTarget(nBits, nValueIn, nTimeWeight, hash), ReferenceStakeKernelTarget(nBits, nValueIn, nTimeWeight, hash));
+
+    const CBigNum bnTarget = ReferenceStakeTarget(nBits, nValueIn, nTimeWeight);
+    if (bnTarget < 0 || bnTarget > CBigNum(ArithToUint256(~arith_uint256())))
+        return;
+    const arith_uint256 target = UintToArith256(bnTarget.getuint256());
+    std::vector<arith_uint256> vEdges{target};
+    if (target != 0)
+        vEdges.push_back(target - 1);
+    if (target != ~arith_uint256())
+        vEdges.push_back(target + 1);
+    for (const arith_uint256& edge : vEdges) {
+        const uint256 hashEdge = ArithToUint256(edge);
+        BOOST_CHECK_EQUAL(CheckStakeKernelTarget(nBits, nValueIn, nTimeWeight, hashEdge), ReferenceStakeKernelTarget(nBits, nValueIn, nTimeWeight, hashEdge));
+    }
+    BOOST_CHECK(CheckStakeKernelTarget(nBits, nValueIn, nTimeWeight, ArithToUint256(target)));
+}
+
+BOOST_AUTO_TEST_CASE(stake_kernel_target_vectors)
+{
+    // Targets of historical blocks, the limits and some malformed encodings
+    const std::vector<unsigned int> vBits{
+        0x1c1ee519, 0x1c1f05ae, 0x1c1f42a4, 0x1c00ffff, 0x19023c6a, 0x1d00ffff,
+        0x1e0fffff, 0x1f00ffff, 0x207fffff, 0x21008000, 0x22000001, 0x23000001,
+        0x00000000, 0x01003456, 0x02000056, 0x03123456, 0x04923456, 0x01fedcba,
+        0x05009234, 0x1c800000, 0x1c923456, 0xff123456};
+    const std::vector<int64_t> vValue{
+        0, 1, COIN - 1, COIN, 12345678901, 1000 * COIN, 2000000000 * COIN,
+        std::numeric_limits<uint32_t>::max() * COIN + COIN - 1,
+        (int64_t)std::numeric_limits<uint32_t>::max() * COIN + COIN,
+        std::numeric_limits<int64_t>::max(), -1, -COIN};
+    const std::vector<int64_t> vWeight{
+        0, 1, 24 * 60 * 60 - 1, 24 * 60 * 60, 60 * 60 * 24 * 30, 60 * 60 * 24 * 90,
+        std::numeric_limits<uint32_t>::max(), (int64_t)std::numeric_limits<uint32_t>::max() + 1,
+        std::numeric_limits<int64_t>::max(), -24 * 60 * 60};
+    const std::vector<uint256> vHash{
+        uint256(), uint256S("01"), uint256S("00000000ffffffffffffffffffffffffffffffffffffffffffffffffffffffff"),
+        ArithToUint256(~arith_uint256()),
+        uint256S("000000000000000fa1b8c16d2ed3f9bd3da5d64d1ea28a9b7d0e1dd2bb9c1a2d"),
+        uint256S("000000ab6c7f8e9d2f1a0b3c4d5e6f708192a3b4c5d6e7f8091a2b3c4d5e6f70")};
+
+    for (unsigned int nBits : vBits)
+        for (int64_t nValue : vValue)
+            for (int64_t nWeight : vWeight)
+                for (const uint256& hash : vHash)
+                    CheckStakeKernelTargetAgrees(nBits, nValue, nWeight, hash);
+}
+
+BOOST_AUTO_TEST_CASE(stake_kernel_target_random)
+{
+    for (int i = 0; i < 2000; i++) {
+        // Realistic compact targets, stakes up to 2^50 units and ages up to
+        // twice the maximum stake age, plus fully random values
+        const unsigned int nBits = InsecureRandBool() ? (0x19 + InsecureRandRange(8)) << 24 | InsecureRandBits(23) : InsecureRand32();
+        const int64_t nValue = InsecureRandBool() ? InsecureRandBits(InsecureRandRange(51)) : (int64_t)InsecureRandBits(64);
+        const int64_t nWeight = InsecureRandBool() ? InsecureRandRange(60 * 60 * 24 * 180) : (int64_t)InsecureRandBits(64);
+        const uint256 hash = InsecureRandBool() ? InsecureRand256() : ArithToUint256(UintToArith256(InsecureRand256()) >> InsecureRandRange(256));
+        CheckStakeKernelTargetAgrees(nBits, nValue, nWeight, hash);
+    }
+}
+
+// The stake modifiers are resolved against the active chain, so this needs one
+BOOST_FIXTURE_TEST_CASE(stake_kernel_search, TestingSetup)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+
+    // Two block chain whose first block generated the v0.5 stake modifier
+    // for the whole search window
+    const unsigned int nTimeModifier = 1700000000;
+    const unsigned int nTimeTx = nTimeModifier + params.nStakeMinAge;
+    uint256 hashModifier = InsecureRand256();
+    uint256 hashPrev = InsecureRand256();
+    CBlockIndex indexModifier;
+    indexModifier.phashBlock = &hashModifier;
+    indexModifier.nHeight = 1;
+    indexModifier.nTime = nTimeModifier;
+    indexModifier.SetStakeModifier(InsecureRandBits(64), true);
+    CBlockIndex indexPrev;
+    indexPrev.phashBlock = &hashPrev;
+    indexPrev.pprev = &indexModifier;
+    indexPrev.nHeight = 2;
+    indexPrev.nTime = nTimeModifier + 2 * params.nStakeMinAge;
+
+    LOCK(cs_main);
+    int nFound = 0;
+    for (int i = 0; i < 20; i++) {
+        // Easy targets so that kernels are found, and coins that only meet
+        // the min age or the transaction time for part of the window
+        std::vector<CStakeCandidate> vCandidates;
+        for (int c = 0; c < 200; c++) {
+            CStakeCandidate stake;
+            stake.prevout = COutPoint(InsecureRand256(), InsecureRandRange(4));
+            stake.kernel.hashBlock = InsecureRand256();
+            stake.kernel.nTimeBlock = InsecureRandBool() ? nTimeTx - params.nStakeMinAge - InsecureRandRange(90) : nTimeTx - params.nStakeMinAge - InsecureRandRange(params.nStakeMaxAge);
+            stake.kernel.nTxOffset = 81 + InsecureRandRange(100000);
+            stake.kernel.nTimeTx = InsecureRandBool() ? 0 : (InsecureRandRange(8) ? stake.kernel.nTimeBlock - InsecureRandRange(7200) : nTimeTx - InsecureRandRange(60));
+            stake.kernel.txout.nValue = InsecureRandRange(1000 * COIN);
+            vCandidates.push_back(stake);
+        }
+        const unsigned int nBits = 0x1e000000 | (InsecureRandRange(0x10000) + 1) << InsecureRandRange(7);
+        const unsigned int nSearchInterval = 1 + InsecureRandRange(60);
+
+        CStakeKernelSearch search;
+        BOOST_CHECK(search.Prepare(nBits, &indexPrev, nTimeTx, nSearchInterval, vCandidates));
+        BOOST_CHECK_EQUAL(search.size(), vCandidates.size());
+
+        // Every range finds the same kernel as checking one hash at a time
+        const size_t nBegin = InsecureRandRange(vCandidates.size());
+        bool fFound = false;
+        size_t nExpected = 0;
+        unsigned int nTimeExpected = 0;
+        uint256 hashExpected;
+        uint64_t nHashes = 0;
+        for (size_t c = nBegin; c < vCandidates.size() && !fFound; c++) {
+            for (unsigned int n = 0; n < nSearchInterval && !fFound; n++) {
+                const CKernelPrevout& kernel = vCandidates[c].kernel;
+                if (nTimeTx - n < kernel.GetTxTime() || kernel.nTimeBlock + params.nStakeMinAge > nTimeTx - n)
+                    continue;
+                nHashes++;
+                uint256 hash;
+                if (CheckStakeKernelHash(nBits, &indexPrev, kernel, vCandidates[c].prevout, nTimeTx - n, hash)) {
+                    fFound = true;
+                    nExpected = c;
+                    nTimeExpected = nTimeTx - n;
+                    hashExpected = hash;
+                }
+            }
+        }
+
+        size_t nCandidate;
+        unsigned int nTimeKernel;
+        uint256 hashProofOfStake;
+        CStakeKernelSearch::Work work;
+        BOOST_CHECK_EQUAL(search.Search(nBegin, vCandidates.size(), nCandidate, nTimeKernel, hashProofOfStake, &work), fFound);
+        if (fFound) {
+            nFound++;
+            BOOST_CHECK_EQUAL(nCandidate, nExpected);
+            BOOST_CHECK_EQUAL(nTimeKernel, nTimeExpected);
+            BOOST_CHECK(hashProofOfStake == hashExpected);
+            BOOST_CHECK(search[nCandidate].prevout == vCandidates[nExpected].prevout);
+            // Whole batches are hashed, up to the one holding the kernel
+            BOOST_CHECK(work.nScanned > nCandidate - nBegin);
+            BOOST_CHECK(work.nHashes >= nHashes);
+        } else {
+            // Every candidate is hashed once per timestamp it may stake at
+            BOOST_CHECK_EQUAL(work.nScanned, vCandidates.size() - nBegin);
+            BOOST_CHECK_EQUAL(work.nHashes, nHashes);
+        }
+    }
+    BOOST_CHECK(nFound > 0);
+}
+
+// The generations the kernel modifier walks find, for comparison with the
+// stake modifier timeline
+static bool ReferenceModifierV05(const CBlockIndex* pindexPrev, int64_t nTimeMax, const CBlockIndex*& pindexModifier)
+{
+    const CBlockIndex* pindex = pindexPrev;
+    int64_t nModifierTime = pindex->GetBlockTime();
+    while (nModifierTime > nTimeMax) {
+        if (!pindex->pprev)
+            return false;
+        pindex = pindex->pprev;
+        if (pindex->GeneratedStakeModifier())
+            nModifierTime = pindex->GetBlockTime();
+    }
+    pindexModifier = pindex;
+    return true;
+}
+
+static bool ReferenceModifierV03(const CBlockIndex* pindexFrom, const CBlockIndex* pindexLast, int64_t nTimeMin, const CBlockIndex*& pindexModifier)
+{
+    std::vector<const CBlockIndex*> vPath;
+    for (const CBlockIndex* pindex = pindexLast; pindex != pindexFrom; pindex = pindex->pprev)
+        vPath.push_back(pindex);
+    for (auto it = vPath.rbegin(); it != vPath.rend(); ++it) {
+        if ((*it)->GeneratedStakeModifier() && (*it)->GetBlockTime() >= nTimeMin) {
+            pindexModifier = *it;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Extend a chain by blocks with jittered timestamps, some of which generate
+// a stake modifier
+static void BuildModifierChain(std::vector<CBlockIndex>& blocks, std::vector<uint256>& hashes, CBlockIndex* pindexFork, size_t nBlocks)
+{
+    blocks.resize(nBlocks);
+    hashes.resize(nBlocks);
+    for (size_t i = 0; i < nBlocks; i++) {
+        CBlockIndex& block = blocks[i];
+        CBlockIndex* pprev = i > 0 ? &blocks[i - 1] : pindexFork;
+        hashes[i] = InsecureRand256();
+        block.phashBlock = &hashes[i];
+        block.pprev = pprev;
+        block.nHeight = pprev ? pprev->nHeight + 1 : 0;
+        block.nTime = 1600000000 + block.nHeight * 600 + InsecureRandRange(3000);
+        if (!pprev || InsecureRandRange(6) == 0)
+            block.SetStakeModifier(InsecureRandBits(64), true);
+        else
+            block.SetStakeModifier(pprev->nStakeModifier, false);
+        block.BuildSkip();
+    }
+}
+
+static void CheckModifierTimeline(CStakeModifierTimeline& timeline, const CChain& chain, const std::vector<const CBlockIndex*>& vTips)
+{
+    for (int i = 0; i < 200; i++) {
+        const CBlockIndex* pindexTip = vTips[InsecureRandRange(vTips.size())];
+        const CBlockIndex* pindexPrev = pindexTip->GetAncestor(InsecureRandRange(pindexTip->nHeight + 1));
+
+        const int64_t nTimeMax = pindexPrev->GetBlockTime() - 1 - InsecureRandRange(pindexPrev->nHeight * 600 + 1200);
+        const CBlockIndex* pindexExpected = nullptr;
+        CStakeModifierTimeline::Entry entry;
+        const bool fExpected = ReferenceModifierV05(pindexPrev, nTimeMax, pindexExpected);
+        BOOST_CHECK_EQUAL(timeline.FindLatestAtOrBefore(chain, pindexPrev, nTimeMax, entry), fExpected);
+        if (fExpected) {
+            BOOST_CHECK_EQUAL(entry.nHeight, pindexExpected->nHeight);
+            BOOST_CHECK_EQUAL(entry.nTime, pindexExpected->GetBlockTime());
+            BOOST_CHECK_EQUAL(entry.nStakeModifier, pindexExpected->nStakeModifier);
+        }
+
+        const CBlockIndex* pindexFrom = pindexTip->GetAncestor(InsecureRandRange(pindexTip->nHeight + 1));
+        const int64_t nTimeMin = pindexFrom->GetBlockTime() + InsecureRandRange(12000);
+        pindexExpected = nullptr;
+        const bool fExpectedV03 = ReferenceModifierV03(pindexFrom, pindexTip, nTimeMin, pindexExpected);
+        BOOST_CHECK_EQUAL(timeline.FindFirstAtOrAfter(chain, pindexFrom, pindexTip, nTimeMin, entry), fExpectedV03);
+        if (fExpectedV03) {
+            BOOST_CHECK_EQUAL(entry.nHeight, pindexExpected->nHeight);
+            BOOST_CHECK_EQUAL(entry.nTime, pindexExpected->GetBlockTime());
+            BOOST_CHECK_EQUAL(entry.nStakeModifier, pindexExpected->nStakeModifier);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stake_modifier_timeline)
+{
+    std::vector<CBlockIndex> blocks;
+    std::vector<uint256> hashes;
+    BuildModifierChain(blocks, hashes, nullptr, 2000);
+    std::vector<CBlockIndex> branch;
+    std::vector<uint256> branchHashes;
+    BuildModifierChain(branch, branchHashes, &blocks[1500], 800);
+
+    CChain chain;
+    chain.SetTip(&blocks.back());
+    CStakeModifierTimeline timeline;
+
+    // Blocks on the active chain and on the side branch
+    CheckModifierTimeline(timeline, chain, {&blocks.back(), &branch.back()});
+    BOOST_CHECK(timeline.size() > 0);
+
+    // After a reorg to the side branch and back
+    chain.SetTip(&branch.back());
+    CheckModifierTimeline(timeline, chain, {&blocks.back(), &branch.back()});
+    chain.SetTip(&blocks[1700]);
+    CheckModifierTimeline(timeline, chain, {&blocks.back(), &branch.back()});
+}
+
+// The stake modifier as computed before candidates carried their selection
+// hash: every round hashes every candidate again
+static bool ReferenceNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    const CBlockIndex* pindexPrev = pindexCurrent->pprev;
+    nStakeModifier = 0;
+    fGeneratedStakeModifier = false;
+    if (!pindexPrev) {
+        fGeneratedStakeModifier = true;
+        return true;
+    }
+    const CBlockIndex* pindex = pindexPrev;
+    while (pindex->pprev && !pindex->GeneratedStakeModifier())
+        pindex = pindex->pprev;
+    nStakeModifier = pindex->nStakeModifier;
+    const int64_t nModifierTime = pindex->GetBlockTime();
+    if (nModifierTime / params.nModifierInterval >= pindexPrev->GetBlockTime() / params.nModifierInterval)
+        return true;
+    if (nModifierTime / params.nModifierInterval >= pindexCurrent->GetBlockTime() / params.nModifierInterval && IsProtocolV04(pindexCurrent->nTime))
+        return true;
+
+    std::vector<int64_t> vSection;
+    int64_t nSelectionInterval = 0;
+    for (int nSection = 0; nSection < 64; nSection++) {
+        vSection.push_back(params.nModifierInterval * 63 / (63 + ((63 - nSection) * (MODIFIER_INTERVAL_RATIO - 1))));
+        nSelectionInterval += vSection.back();
+    }
+    std::vector<const CBlockIndex*> vSorted;
+    const int64_t nSelectionIntervalStart = (pindexPrev->GetBlockTime() / params.nModifierInterval) * params.nModifierInterval - nSelectionInterval;
+    for (pindex = pindexPrev; pindex && pindex->GetBlockTime() >= nSelectionIntervalStart; pindex = pindex->pprev)
+        vSorted.push_back(pindex);
+    std::sort(vSorted.begin(), vSorted.end(), [](const CBlockIndex* a, const CBlockIndex* b) {
+        if (a->GetBlockTime() != b->GetBlockTime())
+            return a->GetBlockTime() < b->GetBlockTime();
+        return UintToArith256(a->GetBlockHash()) < UintToArith256(b->GetBlockHash());
+    });
+
+    uint64_t nStakeModifierNew = 0;
+    int64_t nSelectionIntervalStop = nSelectionIntervalStart;
+    std::set<const CBlockIndex*> setSelected;
+    for (int nRound = 0; nRound < std::min(64, (int)vSorted.size()); nRound++) {
+        nSelectionIntervalStop += vSection[nRound];
+        const CBlockIndex* pindexSelected = nullptr;
+        arith_uint256 hashBest;
+        for (const CBlockIndex* pindexCandidate : vSorted) {
+            if (pindexSelected && pindexCandidate->GetBlockTime() > nSelectionIntervalStop)
+                break;
+            if (setSelected.count(pindexCandidate))
+                continue;
+            CDataStream ss(SER_GETHASH, 0);
+            ss << (pindexCandidate->IsProofOfStake() ? pindexCandidate->hashProofOfStake : pindexCandidate->GetBlockHash()) << nStakeModifier;
+            arith_uint256 hashSelection = UintToArith256(Hash(ss.begin(), ss.end()));
+            if (pindexCandidate->IsProofOfStake())
+                hashSelection >>= 32;
+            if (!pindexSelected || hashSelection < hashBest) {
+                hashBest = hashSelection;
+                pindexSelected = pindexCandidate;
+            }
+        }
+        if (!pindexSelected)
+            return false;
+        nStakeModifierNew |= ((uint64_t)pindexSelected->GetStakeEntropyBit()) << nRound;
+        setSelected.insert(pindexSelected);
+    }
+    nStakeModifier = nStakeModifierNew;
+    fGeneratedStakeModifier = true;
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(stake_modifier_compute)
+{
+    // A chain of mixed proof-of-work and proof-of-stake blocks, with jittered
+    // timestamps, starting an hour before the mainnet v0.4 protocol switch
+    const unsigned int nTimeStart = 1685481644;
+    const size_t nBlocks = 3000;
+    std::vector<CBlockIndex> blocks(nBlocks);
+    std::vector<uint256> hashes(nBlocks);
+    LOCK(cs_main);
+    int nGenerated = 0;
+    for (size_t i = 0; i < nBlocks; i++) {
+        CBlockIndex& block = blocks[i];
+        hashes[i] = InsecureRand256();
+        block.phashBlock = &hashes[i];
+        block.pprev = i > 0 ? &blocks[i - 1] : nullptr;
+        block.nHeight = i;
+        block.nTime = nTimeStart + i * 60 + InsecureRandRange(120);
+        if (InsecureRandBool()) {
+            block.SetProofOfStake();
+            block.hashProofOfStake = InsecureRand256();
+        }
+        block.SetStakeEntropyBit(InsecureRandBits(1));
+
+        uint64_t nStakeModifier;
+        bool fGenerated;
+        BOOST_REQUIRE(ComputeNextStakeModifier(&block, nStakeModifier, fGenerated));
+        uint64_t nExpected;
+        bool fExpected;
+        BOOST_REQUIRE(ReferenceNextStakeModifier(&block, nExpected, fExpected));
+        BOOST_CHECK_EQUAL(nStakeModifier, nExpected);
+        BOOST_CHECK_EQUAL(fGenerated, fExpected);
+        block.SetStakeModifier(nStakeModifier, fGenerated);
+        nGenerated += fGenerated;
+    }
+    BOOST_CHECK(nGenerated > 100);
+}
+
+BOOST_AUTO_TEST_CASE(stake_version_supermajority)
+{
+    // A chain of mixed proof-of-work and proof-of-stake blocks whose versions
+    // rise over time, as during a soft fork
+    const size_t nBlocks = 5000;
+    std::vector<CBlockIndex> blocks(nBlocks);
+    for (size_t i = 0; i < nBlocks; i++) {
+        CBlockIndex& block = blocks[i];
+        block.pprev = i > 0 ? &blocks[i - 1] : nullptr;
+        block.nHeight = i;
+        block.BuildSkip();
+        if (InsecureRandRange(3) != 0)
+            block.SetProofOfStake();
+        block.nVersion = 1 + (InsecureRandRange(nBlocks) < i) + (InsecureRandRange(2 * nBlocks) < i) + InsecureRandBool();
+    }
+
+    // Results of the walk, before the versions are counted
+    const std::vector<std::pair<unsigned int, unsigned int>> vWindows{{900, 1000}, {90, 100}, {1, 1}, {750, 1000}, {4000, 5000}};
+    std::vector<bool> vExpected;
+    for (const CBlockIndex& block : blocks)
+        for (int minVersion = STAKE_VERSION_MIN_TRACKED; minVersion <= STAKE_VERSION_MAX_TRACKED; minVersion++)
+            for (const std::pair<unsigned int, unsigned int>& window : vWindows)
+                vExpected.push_back(IsSuperMajority(minVersion, &block, window.first, window.second));
+
+    for (CBlockIndex& block : blocks)
+        block.BuildChainStake();
+
+    size_t n = 0, nMajority = 0;
+    for (const CBlockIndex& block : blocks) {
+        for (int minVersion = STAKE_VERSION_MIN_TRACKED; minVersion <= STAKE_VERSION_MAX_TRACKED; minVersion++) {
+            for (const std::pair<unsigned int, unsigned int>& window : vWindows) {
+                unsigned int nFound;
+                BOOST_CHECK(block.CountStakeVersion(minVersion, window.second, nFound));
+                BOOST_CHECK_EQUAL(IsSuperMajority(minVersion, &block, window.first, window.second), vExpected[n]);
+                nMajority += vExpected[n];
+                n++;
+            }
+        }
+    }
+    BOOST_CHECK(nMajority > 0 && nMajority < n);
+
+    // Versions outside of the tracked range are walked
+    unsigned int nFound;
+    BOOST_CHECK(!blocks.back().CountStakeVersion(STAKE_VERSION_MAX_TRACKED + 1, 1000, nFound));
+    BOOST_CHECK(!IsSuperMajority(STAKE_VERSION_MAX_TRACKED + 1, &blocks.back(), 1, 1000));
+}
+
+// A proof-of-stake block extending the genesis block, staking a coin added to
+// the coins of the tip
+static CBlock MakeStakeBlock(const CKey& key, const COutPoint& prevout, unsigned int nTime)
+{
+    CBlock block;
+    block.hashPrevBlock = Params().GetConsensus().hashGenesisBlock;
+    block.nTime = nTime;
+    block.nFlags = CBlockIndex::BLOCK_PROOF_OF_STAKE;
+
+    CMutableTransaction txCoinBase;
+    txCoinBase.nTime = nTime;
+    txCoinBase.vin.resize(1);
+    txCoinBase.vin[0].prevout.SetNull();
+    txCoinBase.vin[0].scriptSig = CScript() << 1 << OP_0;
+    txCoinBase.vout.resize(1);
+    txCoinBase.vout[0].SetEmpty();
+    block.vtx.push_back(MakeTransactionRef(std::move(txCoinBase)));
+
+    CMutableTransaction txCoinStake;
+    txCoinStake.nTime = nTime;
+    txCoinStake.vin.emplace_back(prevout);
+    txCoinStake.vout.resize(2);
+    txCoinStake.vout[0].SetEmpty();
+    txCoinStake.vout[1] = CTxOut(1000 * COIN, GetScriptForRawPubKey(key.GetPubKey()));
+    block.vtx.push_back(MakeTransactionRef(std::move(txCoinStake)));
+
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    BOOST_CHECK(key.Sign(block.GetHash(), block.vchBlockSig));
+    return block;
+}
+
+BOOST_FIXTURE_TEST_CASE(stake_block_precheck, TestingSetup)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const COutPoint prevout(InsecureRand256(), 0);
+    LOCK(cs_main);
+    const unsigned int nTimeGenesis = ::ChainActive().Genesis()->nTime;
+    const unsigned int nTimeMature = nTimeGenesis + Params().GetConsensus().nStakeMinAge;
+    ::ChainstateActive().CoinsTip().AddCoin(prevout, Coin(CTxOut(1000 * COIN, GetScriptForRawPubKey(key.GetPubKey())), 0, false, false, nTimeGenesis), false);
+
+    BlockValidationState state;
+    bool fDuplicate = true;
+    BOOST_CHECK(PreCheckProofOfStake(MakeStakeBlock(key, prevout, nTimeMature), state, fDuplicate));
+    BOOST_CHECK(!fDuplicate);
+
+    // The coinstake cannot be later than the block
+    CBlock block = MakeStakeBlock(key, prevout, nTimeMature);
+    block.nTime--;
+    BOOST_CHECK(key.Sign(block.GetHash(), block.vchBlockSig));
+    BOOST_CHECK(!PreCheckProofOfStake(block, state, fDuplicate));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-cs-time");
+
+    // A block signed by another key than the coinstake pays to is invalid,
+    // but not if the transactions are not those of the header
+    CKey keyOther;
+    keyOther.MakeNewKey(true);
+    block = MakeStakeBlock(key, prevout, nTimeMature);
+    BOOST_CHECK(keyOther.Sign(block.GetHash(), block.vchBlockSig));
+    state = BlockValidationState();
+    BOOST_CHECK(!PreCheckProofOfStake(block, state, fDuplicate));
+    BOOST_CHECK(state.GetResult() == BlockValidationResult::BLOCK_CONSENSUS);
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-blk-sign");
+
+    block = MakeStakeBlock(key, prevout, nTimeMature);
+    CMutableTransaction txCoinStake(*block.vtx[1]);
+    txCoinStake.vout[1].scriptPubKey = GetScriptForRawPubKey(keyOther.GetPubKey());
+    block.vtx[1] = MakeTransactionRef(std::move(txCoinStake));
+    state = BlockValidationState();
+    BOOST_CHECK(!PreCheckProofOfStake(block, state, fDuplicate));
+    BOOST_CHECK(state.GetResult() == BlockValidationResult::BLOCK_MUTATED);
+
+    // The kernel must be an unspent output old enough to stake
+    state = BlockValidationState();
+    BOOST_CHECK(!PreCheckProofOfStake(MakeStakeBlock(key, COutPoint(InsecureRand256(), 0), nTimeMature), state, fDuplicate));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-cs-kernel-missing");
+
+    state = BlockValidationState();
+    BOOST_CHECK(!PreCheckProofOfStake(MakeStakeBlock(key, prevout, nTimeMature - 1), state, fDuplicate));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-cs-kernel-immature");
+
+    // Off the tip, the kernel is left to the full checks
+    block = MakeStakeBlock(key, COutPoint(InsecureRand256(), 0), nTimeMature);
+    block.hashPrevBlock = InsecureRand256();
+    BOOST_CHECK(key.Sign(block.GetHash(), block.vchBlockSig));
+    state = BlockValidationState();
+    BOOST_CHECK(PreCheckProofOfStake(block, state, fDuplicate));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <bignum.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <pow.h>
@@ -527,4 +528,49 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+// The retarget as it was computed before fixed-width integers
+static unsigned int ReferenceNextTargetRequired(unsigned int nBitsPrev, int64_t nActualSpacing, int64_t nTargetSpacing, const Consensus::Params& params)
+{
+    CBigNum bnNew;
+    bnNew.SetCompact(nBitsPrev);
+    if (nTargetSpacing > 0) {
+        int64_t nInterval = params.nTargetTimespan / nTargetSpacing;
+        bnNew *= ((nInterval - 1) * nTargetSpacing + nActualSpacing + nActualSpacing);
+        bnNew /= ((nInterval + 1) * nTargetSpacing);
+    }
+    if (bnNew > CBigNum(params.powLimit))
+        bnNew = CBigNum(params.powLimit);
+    return bnNew.GetCompact();
+}
+
+/* Test the fixed-width retarget against the original CBigNum computation */
+BOOST_AUTO_TEST_CASE(calculate_next_target_bignum)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    const std::vector<unsigned int> vBits{
+        0x1c1ee519, 0x19023c6a, 0x1c1ef882, 0x19024189, 0x1c1f05ae, 0x19023ad3,
+        0x190244e6, 0x1c00ffff, 0x1c00fc48, 0x1e0fffff, 0x207fffff, 0x00000000,
+        0x01003456, 0x03123456, 0x04923456, 0x1c923456};
+    const std::vector<int64_t> vTargetSpacing{
+        0, params.nStakeTargetSpacing, params.nStakeTargetSpacing * 2, params.nStakeTargetSpacing * 6,
+        params.nTargetSpacingWorkMax};
+    const std::vector<int64_t> vActualSpacing{-7200, -3600, -60, -1, 0, 1, 20, 60, 359, 360, 10001, 100000};
+
+    for (unsigned int nBits : vBits)
+        for (int64_t nTargetSpacing : vTargetSpacing)
+            for (int64_t nActualSpacing : vActualSpacing)
+                BOOST_CHECK_EQUAL(CalculateNextTargetRequired(nBits, nActualSpacing, nTargetSpacing, params),
+                                  ReferenceNextTargetRequired(nBits, nActualSpacing, nTargetSpacing, params));
+
+    for (int i = 0; i < 1000; i++) {
+        const unsigned int nBits = (InsecureRandRange(0x21)) << 24 | InsecureRandBits(24);
+        const int64_t nTargetSpacing = InsecureRandRange(params.nTargetSpacingWorkMax + 1);
+        const int64_t nActualSpacing = (int64_t)InsecureRandRange(107200) - 7200;
+        BOOST_CHECK_EQUAL(CalculateNextTargetRequired(nBits, nActualSpacing, nTargetSpacing, params),
+                          ReferenceNextTargetRequired(nBits, nActualSpacing, nTargetSpacing, params));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
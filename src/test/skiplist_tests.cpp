@@ -187,4 +187,45 @@ BOOST_AUTO_TEST_CASE(findearliestatleast_edge_test)
     BOOST_CHECK(ret2->nTimeMax >= 200 && ret2->nHeight == 4);
 }
 
+BOOST_AUTO_TEST_CASE(lastblockindex_test)
+{
+    // Two branches off a common chain, with runs of both block types
+    std::vector<CBlockIndex> vBlocksMain(1000);
+    std::vector<CBlockIndex> vBlocksSide(200);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : nullptr;
+        if (i > 10 && InsecureRandRange(4) != 0)
+            vBlocksMain[i].SetProofOfStake();
+    }
+    for (unsigned int i=0; i<vBlocksSide.size(); i++) {
+        vBlocksSide[i].nHeight = i + 500;
+        vBlocksSide[i].pprev = i ? &vBlocksSide[i - 1] : &vBlocksMain[499];
+        if (InsecureRandBool())
+            vBlocksSide[i].SetProofOfStake();
+    }
+
+    // Results of the walk, before the pointers are built
+    std::vector<std::pair<const CBlockIndex*, const CBlockIndex*>> vExpected;
+    for (const std::vector<CBlockIndex>* blocks : {&vBlocksMain, &vBlocksSide})
+        for (const CBlockIndex& block : *blocks)
+            vExpected.emplace_back(GetLastBlockIndex(&block, true), GetLastBlockIndex(&block, false));
+    BOOST_CHECK(GetLastBlockIndex(&vBlocksMain[5], true) == &vBlocksMain[0]);
+    BOOST_CHECK(GetLastBlockIndex(nullptr, true) == nullptr);
+
+    for (CBlockIndex& block : vBlocksMain)
+        block.BuildLastBlockIndex();
+    for (CBlockIndex& block : vBlocksSide)
+        block.BuildLastBlockIndex();
+
+    size_t n = 0;
+    for (const std::vector<CBlockIndex>* blocks : {&vBlocksMain, &vBlocksSide}) {
+        for (const CBlockIndex& block : *blocks) {
+            BOOST_CHECK(GetLastBlockIndex(&block, true) == vExpected[n].first);
+            BOOST_CHECK(GetLastBlockIndex(&block, false) == vExpected[n].second);
+            n++;
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
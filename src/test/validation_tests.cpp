@@ -4,6 +4,8 @@
 
 #include <chainparams.h>
 #include <net.h>
+#include <node/blockindexsnapshot.h>
+#include <txdb.h>
 #include <validation.h>
 
 #include <test/util/setup_common.h>
@@ -29,4 +31,44 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+BOOST_AUTO_TEST_CASE(block_index_snapshot)
+{
+    LOCK(cs_main);
+    const Consensus::Params& params = Params().GetConsensus();
+    const CBlockIndex* pindexGenesis = ::ChainActive().Genesis();
+    BlockManager blockman;
+    auto insert = [&](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return blockman.InsertBlockIndex(hash); };
+
+    // The snapshot is read once, as the database changes after it is loaded
+    BOOST_CHECK(DumpBlockIndexSnapshot());
+    BOOST_CHECK(LoadBlockIndexSnapshot(params, *pblocktree, true, insert));
+    BOOST_CHECK_EQUAL(blockman.m_block_index.size(), 1U);
+    const CBlockIndex* pindex = blockman.m_block_index.at(pindexGenesis->GetBlockHash());
+    BOOST_CHECK(pindex->pprev == nullptr);
+    BOOST_CHECK_EQUAL(pindex->nStatus, pindexGenesis->nStatus);
+    BOOST_CHECK_EQUAL(pindex->nTx, pindexGenesis->nTx);
+    BOOST_CHECK_EQUAL(pindex->nMoneySupply, pindexGenesis->nMoneySupply);
+    BOOST_CHECK_EQUAL(pindex->nStakeModifier, pindexGenesis->nStakeModifier);
+    BOOST_CHECK_EQUAL(pindex->nStakeModifierChecksum, pindexGenesis->nStakeModifierChecksum);
+    blockman.Unload();
+    BOOST_CHECK(!LoadBlockIndexSnapshot(params, *pblocktree, true, insert));
+    BOOST_CHECK(blockman.m_block_index.empty());
+
+    // Nor is it read when not used, or altered
+    BOOST_CHECK(DumpBlockIndexSnapshot());
+    BOOST_CHECK(!LoadBlockIndexSnapshot(params, *pblocktree, false, insert));
+    BOOST_CHECK(DumpBlockIndexSnapshot());
+    BOOST_CHECK(!LoadBlockIndexSnapshot(params, *pblocktree, false, insert));
+    BOOST_CHECK(!LoadBlockIndexSnapshot(params, *pblocktree, true, insert));
+
+    BOOST_CHECK(DumpBlockIndexSnapshot());
+    FILE* file = fsbridge::fopen(GetBlockIndexSnapshotPath(), "rb+");
+    BOOST_REQUIRE(file);
+    BOOST_CHECK_EQUAL(fseek(file, 20, SEEK_SET), 0);
+    BOOST_CHECK_EQUAL(fputc(0xff, file), 0xff);
+    fclose(file);
+    BOOST_CHECK(!LoadBlockIndexSnapshot(params, *pblocktree, true, insert));
+    BOOST_CHECK(blockman.m_block_index.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,9 +12,12 @@
 #include <primitives/block.h>
 
 #include "addressindex.h"
+#include "kernelprevout.h"
 #include "spentindex.h"
 #include "timestampindex.h"
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -40,6 +43,10 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to all block filter index caches combined in MiB.
 static const int64_t max_filter_index_cache = 1024;
+//! Max memory allocated to the address index database cache (MiB)
+static const int64_t nMaxAddressIndexCache = 1024;
+//! Max memory allocated to the spent index database cache (MiB)
+static const int64_t nMaxSpentIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
@@ -49,6 +56,7 @@ class CCoinsViewDB final : public CCoinsView
 {
 protected:
     CDBWrapper db;
+    std::atomic<uint64_t> m_flush_count{0};
 
 public:
     /**
@@ -63,6 +71,9 @@ public:
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override;
     CCoinsViewCursor* Cursor() const override;
 
+    //! Number of batch writes completed, for readers that need to know whether the database changed
+    uint64_t GetFlushCount() const { return m_flush_count; }
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
@@ -133,17 +144,8 @@ public:
 
     bool ReadTxIndex(const uint256& txid, CDiskTxPos& pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>>& list);
-    bool ReadSpentIndex(CSpentIndexKey& key, CSpentIndexValue& value);
-    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>>& vect);
-    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& vect);
-    bool ReadAddressUnspentIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& vect);
-    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount>>& vect);
-    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount>>& vect);
-    bool ReadAddressIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start = 0, int end = 0);
-    bool WriteTimestampIndex(const CTimestampIndexKey& timestampIndex);
-    bool ReadTimestampIndex(const unsigned int& high, const unsigned int& low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int>>& vect);
-    bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey& blockhashIndex, const CTimestampBlockIndexValue& logicalts);
-    bool ReadTimestampBlockIndex(const uint256& hash, unsigned int& logicalTS);
+    bool ReadKernelPrevout(const COutPoint& outpoint, CKernelPrevout& kernel);
+    bool UpdateKernelPrevoutIndex(const std::vector<std::pair<COutPoint, CKernelPrevout>>& vect);
 
 
     bool WriteFlag(const std::string& name, bool fValue);
@@ -154,6 +156,10 @@ public:
     bool WriteSyncCheckpoint(uint256 hashCheckpoint);
     bool ReadCheckpointPubKey(std::string& strPubKey);
     bool WriteCheckpointPubKey(const std::string& strPubKey);
+    // sumcoin: checksum of the block index snapshot matching the database
+    bool ReadBlockIndexSnapshotHash(uint256& hash);
+    bool WriteBlockIndexSnapshotHash(const uint256& hash);
+    bool EraseBlockIndexSnapshotHash();
 };
 
 #endif // BITCOIN_TXDB_H
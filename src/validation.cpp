@@ -17,9 +17,14 @@
 #include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
 #include <index/txindex.h>
 #include <logging.h>
 #include <logging/timer.h>
+#include <node/blockindexsnapshot.h>
+#include <node/coinsprefetch.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
 #include <pow.h>
@@ -81,7 +86,8 @@ bool CBlockIndexWorkComparator::operator()(const CBlockIndex* pa, const CBlockIn
 
 namespace {
 BlockManager g_blockman;
-uint256 vStakeSeen[1024];
+//! sumcoin: hash of the stake of recent proof-of-stake blocks, with the block
+std::pair<uint256, uint256> vStakeSeen[1024];
 } // namespace
 
 std::unique_ptr<CChainState> g_chainstate;
@@ -123,9 +129,6 @@ bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 
-bool fAddressIndex;
-bool fSpentIndex;
-bool fTimestampIndex;
 
 uint256 hashAssumeValid;
 arith_uint256 nMinimumChainWork;
@@ -775,12 +778,12 @@ bool MemPoolAccept::Finalize(ATMPArgs& args, Workspace& ws)
     m_pool.addUnchecked(*entry, setAncestors);
 
     // Add memory address index
-    if (fAddressIndex) {
+    if (g_addressindex) {
         m_pool.addAddressIndex(*entry, m_view);
     }
 
     // Add memory spent index
-    if (fSpentIndex) {
+    if (g_spentindex) {
         m_pool.addSpentIndex(*entry, m_view);
     }
 
@@ -1573,87 +1576,16 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         return DISCONNECT_FAILED;
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>> spentIndex;
+    std::vector<std::pair<COutPoint, CKernelPrevout>> kernelPrevouts;
 
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction& tx = *(block.vtx[i]);
         uint256 hash = tx.GetHash();
 
-
-        if (fAddressIndex) {
-            for (unsigned int k = tx.vout.size(); k-- > 0;) {
-                const CTxOut& out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    uint256 addressHash;
-                    std::vector<unsigned char> addressBytes(32);
-                    std::copy(out.scriptPubKey.begin() + 2, out.scriptPubKey.begin() + 22, addressBytes.begin());
-                    addressHash = uint256(addressBytes);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, addressHash, pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, addressHash, hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    uint256 addressHash;
-                    std::vector<unsigned char> addressBytes(32);
-                    std::copy(out.scriptPubKey.begin() + 3, out.scriptPubKey.begin() + 23, addressBytes.begin());
-                    addressHash = uint256(addressBytes);
-
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, addressHash, pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, addressHash, hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPubkey()) {
-                    uint256 addressHash;
-                    std::vector<unsigned char> addressBytes(32);
-                    std::vector<unsigned char> pubkeyBytes(out.scriptPubKey.begin() + 1, out.scriptPubKey.end() - 1);
-                    uint160 hashBytes = Hash160(pubkeyBytes);
-                    std::copy(hashBytes.begin(), hashBytes.end(), addressBytes.begin());
-                    addressHash = uint256(addressBytes);
-                    // undo spending activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, addressHash, pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // restore unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, addressHash, hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToWitnessPubkeyHash()) {
-                    uint256 addressHash;
-                    std::vector<unsigned char> addressBytes(32);
-                    std::copy(out.scriptPubKey.begin() + 2, out.scriptPubKey.end(), addressBytes.begin());
-                    addressHash = uint256(addressBytes);
-
-                    // undo spending activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(4, addressHash, pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // restore unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(4, addressHash, hash, k), CAddressUnspentValue()));
-                } else if (out.scriptPubKey.IsPayToWitnessScriptHash()) {
-                    uint256 addressHash;
-                    std::vector<unsigned char> addressBytes(32);
-                    std::copy(out.scriptPubKey.begin() + 2, out.scriptPubKey.end(), addressBytes.begin());
-                    addressHash = uint256(addressBytes);
-
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(3, addressHash, pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(3, addressHash, hash, k), CAddressUnspentValue()));
-
-                } else {
-                    continue;
-                }
-            }
-        }
+        // sumcoin: outputs of this block no longer exist on the active chain
+        for (unsigned int k = 0; k < tx.vout.size(); k++)
+            kernelPrevouts.push_back(std::make_pair(COutPoint(hash, k), CKernelPrevout()));
 
         bool is_coinbase = tx.IsCoinBase();
         bool is_coinstake = tx.IsCoinStake();
@@ -1683,86 +1615,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
                 int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
-
-
-                const CTxIn input = tx.vin[j];
-
-                if (fSpentIndex) {
-                    // undo and delete the spent index
-                    spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue()));
-                }
-
-                if (fAddressIndex) {
-                    const CTxOut& prevout = view.GetOutputFor(tx.vin[j]);
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        uint256 addressHash;
-                        std::vector<unsigned char> addressBytes(32);
-                        std::copy(prevout.scriptPubKey.begin() + 2, prevout.scriptPubKey.begin() + 22, addressBytes.begin());
-                        addressHash = uint256(addressBytes);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(2, addressHash, pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, addressHash, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, pindex->nHeight)));
-
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        uint256 addressHash;
-                        std::vector<unsigned char> addressBytes(32);
-                        std::copy(prevout.scriptPubKey.begin() + 3, prevout.scriptPubKey.begin() + 23, addressBytes.begin());
-                        addressHash = uint256(addressBytes);
-
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin() + 3, prevout.scriptPubKey.begin() + 23);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, addressHash, pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, addressHash, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, pindex->nHeight)));
-
-                    } else if (prevout.scriptPubKey.IsPayToPubkey()) {
-                        uint256 addressHash;
-                        std::vector<unsigned char> addressBytes(32);
-                        std::vector<unsigned char> pubkeyBytes(prevout.scriptPubKey.begin() + 1, prevout.scriptPubKey.end() - 1);
-                        uint160 hashBytes = Hash160(pubkeyBytes);
-                        std::copy(hashBytes.begin(), hashBytes.end(), addressBytes.begin());
-                        addressHash = uint256(addressBytes);
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, addressHash, pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, addressHash, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, pindex->nHeight)));
-
-                    } else if (prevout.scriptPubKey.IsPayToWitnessPubkeyHash()) {
-                        uint256 addressHash;
-                        std::vector<unsigned char> addressBytes(32);
-                        std::copy(prevout.scriptPubKey.begin() + 2, prevout.scriptPubKey.end(), addressBytes.begin());
-                        addressHash = uint256(addressBytes);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(4, addressHash, pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(4, addressHash, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, pindex->nHeight)));
-                    } else if (prevout.scriptPubKey.IsPayToWitnessScriptHash()) {
-                        uint256 addressHash;
-                        std::vector<unsigned char> addressBytes(32);
-                        std::copy(prevout.scriptPubKey.begin() + 2, prevout.scriptPubKey.end(), addressBytes.begin());
-                        addressHash = uint256(addressBytes);
-
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin() + 2, prevout.scriptPubKey.begin() + 33);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(3, addressHash, pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, addressHash, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, pindex->nHeight)));
-
-                    } else {
-                        continue;
-                    }
-                }
             }
             // At this point, all of txundo.vprevout should have been moved out.
         }
@@ -1776,17 +1628,9 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
 
     BlockValidationState state;
 
-    if (fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            // return AbortNode(state, "Failed to delete address index");
-            AbortNode(state, "Failed to delete address index");
-            fClean = false;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            // return AbortNode(state, "Failed to write address unspent index");
-            AbortNode(state, "Failed to write address unspent index");
-            fClean = false;
-        }
+    if (!pblocktree->UpdateKernelPrevoutIndex(kernelPrevouts)) {
+        AbortNode(state, "Failed to delete kernel prevout index");
+        fClean = false;
     }
 
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
@@ -1907,9 +1751,18 @@ bool SumcoinContextualBlockChecks(const CBlock& block, BlockValidationState& sta
 {
     uint256 hashProofOfStake = uint256();
     // sumcoin: verify hash target and signature of coinstake tx
-    if (block.IsProofOfStake() && !CheckProofOfStake(state, pindex->pprev, block.vtx[1], block.nBits, hashProofOfStake, block.vtx[1]->nTime ? block.vtx[1]->nTime : block.nTime)) {
-        LogPrintf("WARNING: %s: check proof-of-stake failed for block %s\n", __func__, block.GetHash().ToString());
-        return false; // do not error here as we expect this during initial block download
+    // The signature is verified by the script check threads while the kernel
+    // and the stake modifier are checked here
+    std::unique_ptr<PrecomputedTransactionData> txdata;
+    std::vector<CScriptCheck> vChecks;
+    CCheckQueueControl<CScriptCheck> control(g_parallel_script_checks && block.IsProofOfStake() ? &scriptcheckqueue : nullptr);
+    if (block.IsProofOfStake()) {
+        txdata = MakeUnique<PrecomputedTransactionData>(*block.vtx[1]);
+        if (!CheckProofOfStake(state, pindex->pprev, block.vtx[1], block.nBits, hashProofOfStake, block.vtx[1]->nTime ? block.vtx[1]->nTime : block.nTime, *txdata, g_parallel_script_checks ? &vChecks : nullptr)) {
+            LogPrintf("WARNING: %s: check proof-of-stake failed for block %s\n", __func__, block.GetHash().ToString());
+            return false; // do not error here as we expect this during initial block download
+        }
+        control.Add(vChecks);
     }
 
     // sumcoin: compute stake entropy bit for stake modifier
@@ -1943,6 +1796,11 @@ bool SumcoinContextualBlockChecks(const CBlock& block, BlockValidationState& sta
     if (!CheckStakeModifierCheckpoints(pindex->nHeight, nStakeModifierChecksum))
         return error("ConnectBlock() : Rejected by stake modifier checkpoint height=%d, modifier=0x%016llx", pindex->nHeight, nStakeModifier);
 
+    if (!control.Wait()) {
+        LogPrintf("WARNING: %s: check proof-of-stake failed for block %s\n", __func__, block.GetHash().ToString());
+        return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "invalid-pos-script", strprintf("%s: VerifyScript failed on coinstake %s", __func__, block.vtx[1]->GetHash().ToString()));
+    }
+
     if (fJustCheck)
         return true;
 
@@ -2164,9 +2022,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     std::vector<std::pair<uint256, CDiskTxPos>> vPos;
     vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
-    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>> spentIndex;
+    std::vector<std::pair<COutPoint, CKernelPrevout>> kernelPrevouts;
 
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
@@ -2209,57 +2065,6 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 LogPrintf("ERROR: %s: contains a non-BIP68-final transaction\n", __func__);
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-nonfinal");
             }
-
-            if (fAddressIndex || fSpentIndex) {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut& prevout = view.GetOutputFor(tx.vin[j]);
-                    uint256 addressHash;
-                    int addressType;
-                    std::vector<unsigned char> addressBytes(32);
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        std::copy(prevout.scriptPubKey.begin() + 2, prevout.scriptPubKey.begin() + 22, addressBytes.begin());
-                        addressHash = uint256(addressBytes);
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        std::copy(prevout.scriptPubKey.begin() + 3, prevout.scriptPubKey.begin() + 23, addressBytes.begin());
-                        addressHash = uint256(addressBytes);
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPubkey()) {
-                        std::vector<unsigned char> pubkeyBytes(prevout.scriptPubKey.begin() + 1, prevout.scriptPubKey.end() - 1);
-                        uint160 hashBytes = Hash160(pubkeyBytes);
-                        std::copy(hashBytes.begin(), hashBytes.end(), addressBytes.begin());
-                        addressHash = uint256(addressBytes);
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToWitnessPubkeyHash()) {
-                        std::copy(prevout.scriptPubKey.begin() + 2, prevout.scriptPubKey.end(), addressBytes.begin());
-                        addressHash = uint256(addressBytes);
-                        addressType = 4;
-                    } else if (prevout.scriptPubKey.IsPayToWitnessScriptHash()) {
-                        std::copy(prevout.scriptPubKey.begin() + 2, prevout.scriptPubKey.end(), addressBytes.begin());
-                        addressHash = uint256(addressBytes);
-                        addressType = 3;
-                    } else {
-                        addressHash.SetNull();
-                        addressType = 0;
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        // record spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, addressHash, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, addressHash, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                    }
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, addressHash)));
-                    }
-                }
-            }
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -2287,74 +2092,18 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
             control.Add(vChecks);
         }
 
-
-        if (fAddressIndex) {
+        // sumcoin: remember what the stake kernel needs about new outputs
+        // and forget the outputs this transaction spends
+        if (!fJustCheck) {
+            if (!tx.IsCoinBase()) {
+                for (const CTxIn& txin : tx.vin)
+                    kernelPrevouts.push_back(std::make_pair(txin.prevout, CKernelPrevout()));
+            }
             for (unsigned int k = 0; k < tx.vout.size(); k++) {
                 const CTxOut& out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    uint256 addressHash;
-                    std::vector<unsigned char> addressBytes(32);
-                    std::copy(out.scriptPubKey.begin() + 2, out.scriptPubKey.begin() + 22, addressBytes.begin());
-                    addressHash = uint256(addressBytes);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, addressHash, pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, addressHash, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPubkey()) {
-                    uint256 addressHash;
-                    std::vector<unsigned char> addressBytes(32);
-                    std::vector<unsigned char> pubkeyBytes(out.scriptPubKey.begin() + 1, out.scriptPubKey.end() - 1);
-                    uint160 hashBytes = Hash160(pubkeyBytes);
-                    std::copy(hashBytes.begin(), hashBytes.end(), addressBytes.begin());
-                    addressHash = uint256(addressBytes);
-                    // undo spending activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, addressHash, pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // restore unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, addressHash, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToWitnessPubkeyHash()) {
-                    uint256 addressHash;
-                    std::vector<unsigned char> addressBytes(32);
-                    std::copy(out.scriptPubKey.begin() + 2, out.scriptPubKey.end(), addressBytes.begin());
-                    addressHash = uint256(addressBytes);
-
-                    // undo spending activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(4, addressHash, pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // restore unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(4, addressHash, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    uint256 addressHash;
-                    std::vector<unsigned char> addressBytes(32);
-                    std::copy(out.scriptPubKey.begin() + 3, out.scriptPubKey.begin() + 23, addressBytes.begin());
-                    addressHash = uint256(addressBytes);
-
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, addressHash, pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, addressHash, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToWitnessScriptHash()) {
-                    uint256 addressHash;
-                    std::vector<unsigned char> addressBytes(32);
-                    std::copy(out.scriptPubKey.begin() + 2, out.scriptPubKey.end(), addressBytes.begin());
-                    addressHash = uint256(addressBytes);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(3, addressHash, pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(3, addressHash, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                } else {
+                if (out.IsEmpty() || out.scriptPubKey.IsUnspendable())
                     continue;
-                }
+                kernelPrevouts.push_back(std::make_pair(COutPoint(txhash, k), CKernelPrevout(pindex->GetBlockHash(), block.nTime, pos.nTxOffset + CBlockHeader::NORMAL_SERIALIZE_SIZE, tx.nTime, out)));
             }
         }
 
@@ -2407,42 +2156,8 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     if (!pblocktree->WriteTxIndex(vPos))
         return AbortNode(state, "Failed to write transaction index");
 
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-    }
-
-    if (fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
-            LogPrintf("write spent index failed");
-            return AbortNode(state, "Failed to write transaction index");
-        }
-
-    if (fTimestampIndex) {
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
-
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
-        }
-
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
-    }
+    if (!pblocktree->UpdateKernelPrevoutIndex(kernelPrevouts))
+        return AbortNode(state, "Failed to write kernel prevout index");
 
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
@@ -2779,6 +2494,8 @@ bool CChainState::ConnectTip(BlockValidationState& state, const CChainParams& ch
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
     {
+        if (g_coins_prefetcher.IsEnabled())
+            g_coins_prefetcher.Connect(pindexNew, CoinsTip(), CoinsDB());
         CCoinsViewCache view(&CoinsTip());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
         GetMainSignals().BlockChecked(blockConnecting, state);
@@ -3366,6 +3083,8 @@ CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block)
     pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
     if (block.nFlags & CBlockIndex::BLOCK_PROOF_OF_STAKE)
         pindexNew->SetProofOfStake();
+    pindexNew->BuildLastBlockIndex();
+    pindexNew->BuildChainStake();
     pindexNew->nChainTrust = (pindexNew->pprev ? pindexNew->pprev->nChainTrust : 0) + GetBlockTrust(*pindexNew);
     pindexNew->RaiseValidity(BLOCK_VALID_TREE);
     if (pindexBestHeader == nullptr || pindexBestHeader->nChainTrust < pindexNew->nChainTrust)
@@ -4048,6 +3767,10 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, Block
         return AbortNode(state, std::string("System error: ") + e.what());
     }
 
+    // Read the coins the block spends while the blocks before it are connected
+    if (g_coins_prefetcher.IsEnabled() && pindex->nHeight > m_chain.Height() + 1)
+        g_coins_prefetcher.Add(block, pindex, CoinsDB());
+
     FlushStateToDisk(chainparams, state, FlushStateMode::NONE);
     CheckBlockIndex(chainparams.GetConsensus());
 
@@ -4068,6 +3791,30 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
         // Therefore, the following critical section must include the CheckBlock() call as well.
         LOCK(cs_main);
 
+        // sumcoin: reject a bad proof-of-stake block before any disk access.
+        // An unrequested block reusing the stake of another one is not stored,
+        // as for the other unrequested blocks AcceptBlock turns down
+        const CBlockIndex* pindexKnown = LookupBlockIndex(pblock->GetHash());
+        const bool fHaveData = pindexKnown && (pindexKnown->nStatus & BLOCK_HAVE_DATA);
+        if (pblock->IsProofOfStake() && !fHaveData) {
+            bool fDuplicate = false;
+            if (!PreCheckProofOfStake(*pblock, state, fDuplicate)) {
+                if (ppindex)
+                    *ppindex = nullptr;
+                GetMainSignals().BlockChecked(*pblock, state);
+                return error("%s: PreCheckProofOfStake FAILED (%s)", __func__, state.ToString());
+            }
+            if (fDuplicate && !::ChainstateActive().IsInitialBlockDownload()) {
+                if (fPoSDuplicate)
+                    *fPoSDuplicate = true;
+                if (!fForceProcessing) {
+                    if (ppindex)
+                        *ppindex = nullptr;
+                    return true;
+                }
+            }
+        }
+
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
         // belt-and-suspenders.
         bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus());
@@ -4083,10 +3830,8 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
         }
 
         if (pindex->IsProofOfStake() && !::ChainstateActive().IsInitialBlockDownload()) {
-            int32_t ndx = univHash(pindex->hashProofOfStake);
-            if (fPoSDuplicate && vStakeSeen[ndx] == pindex->hashProofOfStake)
-                *fPoSDuplicate = true;
-            vStakeSeen[ndx] = pindex->hashProofOfStake;
+            const uint256 hashStake = SerializeHash(pblock->GetProofOfStake());
+            vStakeSeen[univHash(hashStake)] = std::make_pair(hashStake, pindex->GetBlockHash());
         }
     }
 
@@ -4187,8 +3932,17 @@ bool BlockManager::LoadBlockIndex(
     CBlockTreeDB& blocktree,
     std::set<CBlockIndex*, CBlockIndexWorkComparator>& block_index_candidates)
 {
-    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
-        return false;
+    // sumcoin: the snapshot written at the last clean shutdown, if the
+    // database has not changed since, spares iterating the database and
+    // computing the stake modifier checksums in height order
+    const auto insertBlockIndex = [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); };
+    const bool fSnapshot = LoadBlockIndexSnapshot(consensus_params, blocktree, gArgs.GetBoolArg("-blockindexsnapshot", DEFAULT_BLOCK_INDEX_SNAPSHOT), insertBlockIndex);
+    if (!fSnapshot) {
+        // Drop the entries of a snapshot rejected after being read
+        Unload();
+        if (!blocktree.LoadBlockIndexGuts(consensus_params, insertBlockIndex))
+            return false;
+    }
 
     // Calculate nChainTrust
     std::vector<std::pair<int, CBlockIndex*>> vSortedByHeight;
@@ -4228,11 +3982,14 @@ bool BlockManager::LoadBlockIndex(
             pindexBestInvalid = pindex;
         if (pindex->pprev)
             pindex->BuildSkip();
+        pindex->BuildLastBlockIndex();
+        pindex->BuildChainStake();
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
 
         // sumcoin: calculate stake modifier checksum
-        pindex->nStakeModifierChecksum = GetStakeModifierChecksum(pindex);
+        if (!fSnapshot)
+            pindex->nStakeModifierChecksum = GetStakeModifierChecksum(pindex);
         if (::ChainActive().Contains(pindex))
             if (!CheckStakeModifierCheckpoints(pindex->nHeight, pindex->nStakeModifierChecksum))
                 return error("LoadBlockIndex() : Failed stake modifier checkpoint height=%d, modifier=0x%016llx", pindex->nHeight, pindex->nStakeModifier);
@@ -4297,18 +4054,6 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_RE
     pblocktree->ReadReindexing(fReindexing);
     if (fReindexing) fReindex = true;
 
-    // Check whether we have an address index
-    pblocktree->ReadFlag("addressindex", fAddressIndex);
-    LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
-
-    // Check whether we have a timestamp index
-    pblocktree->ReadFlag("timestampindex", fTimestampIndex);
-    LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
-
-    // Check whether we have a spent index
-    pblocktree->ReadFlag("spentindex", fSpentIndex);
-    LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
-
     return true;
 }
 
@@ -4702,10 +4447,13 @@ void UnloadBlockIndex()
 
 bool GetTimestampIndex(const unsigned int& high, const unsigned int& low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int>>& hashes)
 {
-    if (!fTimestampIndex)
+    if (!g_timestampindex)
         return error("Timestamp index not enabled");
 
-    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes))
+    if (!g_timestampindex->BlockUntilSyncedToCurrentChain())
+        return error("Timestamp index is still syncing");
+
+    if (!g_timestampindex->FindBlockHashes(high, low, fActiveOnly, hashes))
         return error("Unable to get hashes for timestamps");
 
     return true;
@@ -4713,7 +4461,7 @@ bool GetTimestampIndex(const unsigned int& high, const unsigned int& low, const
 
 bool GetSpentIndex(CSpentIndexKey& key, CSpentIndexValue& value)
 {
-    if (!fSpentIndex) {
+    if (!g_spentindex) {
         LogPrintf("not spent index\n");
         return false;
     }
@@ -4721,7 +4469,7 @@ bool GetSpentIndex(CSpentIndexKey& key, CSpentIndexValue& value)
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!pblocktree->ReadSpentIndex(key, value)) {
+    if (!g_spentindex->FindSpent(key, value)) {
         LogPrintf("get spent index failed\n");
         return false;
     }
@@ -4729,34 +4477,91 @@ bool GetSpentIndex(CSpentIndexKey& key, CSpentIndexValue& value)
     return true;
 }
 
-bool HashOnchainActive(const uint256& hash)
+// The address index answers from the blocks it has indexed, which trail the
+// chain while it syncs in the background
+static bool AddressIndexReady()
 {
-    CBlockIndex* pblockindex = LookupBlockIndex(hash);
+    if (!g_addressindex)
+        return error("address index not enabled");
 
-    if (!::ChainActive().Contains(pblockindex)) {
-        return false;
-    }
+    if (!g_addressindex->BlockUntilSyncedToCurrentChain())
+        return error("address index is still syncing");
 
     return true;
 }
 
 bool GetAddressIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start, int end)
 {
-    if (!fAddressIndex)
-        return error("address index not enabled");
+    if (!AddressIndexReady())
+        return false;
+
+    if (!g_addressindex->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressIndex(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start, int end)
+{
+    if (!AddressIndexReady())
+        return false;
+
+    if (!g_addressindex->ReadAddressIndexBatch(addresses, addressIndex, start, end))
+        return error("unable to get txids for addresses");
+
+    return true;
+}
+
+bool GetAddressUnspent(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs)
+{
+    if (!AddressIndexReady())
+        return false;
+
+    if (!g_addressindex->ReadAddressUnspentIndexBatch(addresses, unspentOutputs))
+        return error("unable to get txids for addresses");
+
+    return true;
+}
+
+bool IterateAddressIndex(uint256 addressHash, int type, const std::function<bool(const CAddressIndexKey&, CAmount)>& visitor, const CAddressIndexKey* pkeyAfter, bool fDescending, int start, int end)
+{
+    if (!AddressIndexReady())
+        return false;
+
+    if (!g_addressindex->IterateAddressIndex(addressHash, type, visitor, pkeyAfter, fDescending, start, end))
+        return error("unable to get txids for address");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    return true;
+}
+
+bool IterateAddressUnspent(uint256 addressHash, int type, const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& visitor, const CAddressUnspentKey* pkeyAfter, bool fDescending)
+{
+    if (!AddressIndexReady())
+        return false;
+
+    if (!g_addressindex->IterateAddressUnspentIndex(addressHash, type, visitor, pkeyAfter, fDescending))
         return error("unable to get txids for address");
 
     return true;
 }
 
+bool GetAddressBalance(uint256 addressHash, int type, CAddressBalance& balance)
+{
+    if (!AddressIndexReady())
+        return false;
+
+    if (!g_addressindex->ReadAddressBalance(addressHash, type, balance))
+        balance.SetNull();
+
+    return true;
+}
+
 bool GetAddressUnspent(uint256 addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs)
 {
-    if (!fAddressIndex)
-        return error("address index not enabled");
+    if (!AddressIndexReady())
+        return false;
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    if (!g_addressindex->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
         return error("unable to get txids for address");
 
     return true;
@@ -4767,21 +4572,6 @@ bool LoadBlockIndex(const CChainParams& chainparams)
     // Load block index from databases
     bool needs_init = fReindex;
 
-    // Use the provided setting for -addressindex in the new database
-    fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
-    pblocktree->WriteFlag("addressindex", fAddressIndex);
-    LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
-
-    // Use the provided setting for -timestampindex in the new database
-    fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
-    pblocktree->WriteFlag("timestampindex", fTimestampIndex);
-    LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
-
-    // Use the provided setting for -spentindex in the new database
-    fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
-    pblocktree->WriteFlag("spentindex", fSpentIndex);
-    LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
-
     if (!fReindex) {
         bool ret = LoadBlockIndexDB(chainparams);
         if (!ret) return false;
@@ -5020,6 +4810,9 @@ void CChainState::CheckBlockIndex(const Consensus::Params& consensusParams)
         assert(pindex->nHeight == nHeight);                                                                             // nHeight must be consistent.
         assert(pindex->pprev == nullptr || pindex->nChainTrust >= pindex->pprev->nChainTrust);                          // For every block except the genesis block, the chainwork must be larger than the parent's.
         assert(nHeight < 2 || (pindex->pskip && (pindex->pskip->nHeight < nHeight)));                                   // The pskip pointer must point back for all but the first 2 blocks.
+        assert(pindex->pindexLastPoS == (pindex->IsProofOfStake() ? pindex : pindex->pprev ? pindex->pprev->pindexLastPoS : pindex)); // The latest proof-of-stake block pointer must follow the chain.
+        assert(pindex->pindexLastPoW == (pindex->IsProofOfWork() ? pindex : pindex->pprev ? pindex->pprev->pindexLastPoW : pindex)); // The latest proof-of-work block pointer must follow the chain.
+        assert(pindex->nChainStake == (pindex->pprev ? pindex->pprev->nChainStake : 0) + pindex->IsProofOfStake());         // The proof-of-stake block count must follow the chain.
         assert(pindexFirstNotTreeValid == nullptr);                                                                     // All m_blockman.m_block_index entries must at least be TREE valid
         if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TREE) assert(pindexFirstNotTreeValid == nullptr);       // TREE valid implies all parents are TREE valid
         if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_CHAIN) assert(pindexFirstNotChainValid == nullptr);     // CHAIN valid implies all parents are CHAIN valid
@@ -5201,6 +4994,12 @@ bool LoadMempool(CTxMemPool& pool)
     return true;
 }
 
+bool DumpBlockIndexSnapshot()
+{
+    AssertLockHeld(cs_main);
+    return WriteBlockIndexSnapshot(g_blockman.m_block_index, *pblocktree);
+}
+
 bool DumpMempool(const CTxMemPool& pool)
 {
     int64_t start = GetTimeMicros();
@@ -5299,15 +5098,16 @@ static CMainCleanup instance_of_cmaincleanup;
 // age (trust score) of competing branches.
 bool GetCoinAge(const CTransaction& tx, const CCoinsViewCache& view, uint64_t& nCoinAge, unsigned int nTimeTx, bool isTrueCoinAge)
 {
+    AssertLockHeld(cs_main);
     arith_uint256 bnCentSecond = 0; // coin age in the unit of cent-seconds
     nCoinAge = 0;
 
     if (tx.IsCoinBase())
         return true;
 
-    // Transaction index is required to get to block header
-    if (!g_txindex)
-        return false; // Transaction index not available
+    // The coins of the view were confirmed on the chain ending at its best
+    // block, whose block index has the time of each block by height
+    const CBlockIndex* pindexPrev = LookupBlockIndex(view.GetBestBlock());
 
     for (const auto& txin : tx.vin) {
         // First try finding the previous transaction in database
@@ -5319,36 +5119,34 @@ bool GetCoinAge(const CTransaction& tx, const CCoinsViewCache& view, uint64_t& n
         if (nTimeTx < coin.nTime)
             return false; // Transaction timestamp violation
 
-        CDiskTxPos postx;
-        CTransactionRef txPrev;
-        if (g_txindex->FindTxPosition(prevout.hash, postx)) {
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            CBlockHeader header;
-            try {
-                file >> header;
-                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                file >> txPrev;
-            } catch (std::exception& e) {
-                return error("%s() : deserialize or I/O error in GetCoinAge()", __PRETTY_FUNCTION__);
-            }
-            if (txPrev->GetHash() != prevout.hash)
-                return error("%s() : txid mismatch in GetCoinAge()", __PRETTY_FUNCTION__);
+        unsigned int nTimeBlock;
+        if (!coin.IsSpent()) {
+            const CBlockIndex* pindexFrom = pindexPrev ? pindexPrev->GetAncestor(coin.nHeight) : nullptr;
+            if (!pindexFrom)
+                return error("%s() : block of coin %s not found in GetCoinAge()", __PRETTY_FUNCTION__, prevout.ToString());
+            nTimeBlock = pindexFrom->nTime;
+        } else {
+            // Outputs no longer in the view are only in the block files
+            CKernelPrevout kernel;
+            if (!GetKernelPrevout(::ChainActive().Tip(), prevout, kernel))
+                return error("%s() : tx missing in tx index in GetCoinAge()", __PRETTY_FUNCTION__);
+            coin = Coin(kernel.txout, 0, false, false, kernel.nTimeTx);
+            nTimeBlock = kernel.nTimeBlock;
+        }
 
-            if (header.GetBlockTime() + Params().GetConsensus().nStakeMinAge > nTimeTx)
-                continue; // only count coins meeting min age requirement
+        if (nTimeBlock + Params().GetConsensus().nStakeMinAge > nTimeTx)
+            continue; // only count coins meeting min age requirement
 
-            int64_t nValueIn = txPrev->vout[txin.prevout.n].nValue;
-            int nEffectiveAge = nTimeTx - (txPrev->nTime ? txPrev->nTime : header.GetBlockTime());
+        int64_t nValueIn = coin.out.nValue;
+        int nEffectiveAge = nTimeTx - (coin.nTime ? coin.nTime : nTimeBlock);
 
-            if (!isTrueCoinAge || IsProtocolV09(nTimeTx))
-                nEffectiveAge = std::min(nEffectiveAge, 365 * 24 * 60 * 60);
+        if (!isTrueCoinAge || IsProtocolV09(nTimeTx))
+            nEffectiveAge = std::min(nEffectiveAge, 365 * 24 * 60 * 60);
 
-            bnCentSecond += arith_uint256(nValueIn) * nEffectiveAge / CENT;
+        bnCentSecond += arith_uint256(nValueIn) * nEffectiveAge / CENT;
 
-            if (gArgs.GetBoolArg("-printcoinage", false))
-                LogPrintf("coin age nValueIn=%-12lld nTimeDiff=%d bnCentSecond=%s\n", nValueIn, nEffectiveAge, bnCentSecond.ToString());
-        } else
-            return error("%s() : tx missing in tx index in GetCoinAge()", __PRETTY_FUNCTION__);
+        if (gArgs.GetBoolArg("-printcoinage", false))
+            LogPrintf("coin age nValueIn=%-12lld nTimeDiff=%d bnCentSecond=%s\n", nValueIn, nEffectiveAge, bnCentSecond.ToString());
     }
 
     arith_uint256 bnCoinDay = bnCentSecond * CENT / COIN / (24 * 60 * 60);
@@ -5392,5 +5190,46 @@ bool CheckBlockSignature(const CBlock& block)
     CPubKey key(vchPubKey);
     if (block.vchBlockSig.empty())
         return false;
-    return key.Verify(block.GetHash(), block.vchBlockSig);
+    // Cached so that connecting the block, read back from disk, does not
+    // verify the signature again
+    return VerifySignatureCached(block.vchBlockSig, key, block.GetHash(), true);
+}
+
+bool PreCheckProofOfStake(const CBlock& block, BlockValidationState& state, bool& fDuplicate)
+{
+    AssertLockHeld(cs_main);
+    assert(block.IsProofOfStake());
+    const CTransaction& txCoinStake = *block.vtx[1];
+    const unsigned int nTimeTx = txCoinStake.nTime ? txCoinStake.nTime : block.nTime;
+
+    if (!CheckCoinStakeTimestamp(block.GetBlockTime(), nTimeTx))
+        return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-cs-time", "coinstake timestamp violation");
+
+    if (!CheckBlockSignature(block)) {
+        // The transactions may not be those the signed header commits to,
+        // which does not make the block itself invalid
+        bool mutated;
+        if (block.hashMerkleRoot != BlockMerkleRoot(block, &mutated) || mutated)
+            return state.Invalid(BlockValidationResult::BLOCK_MUTATED, "bad-txnmrklroot", "hashMerkleRoot mismatch");
+        return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-blk-sign", strprintf("%s : bad block signature", __func__));
+    }
+
+    const uint256 hashStake = SerializeHash(block.GetProofOfStake());
+    const std::pair<uint256, uint256>& seen = vStakeSeen[univHash(hashStake)];
+    fDuplicate = seen.first == hashStake && seen.second != block.GetHash();
+
+    // The kernel of a block extending the tip must be in the coins of the tip.
+    // A lookup of a missing coin is mostly answered by the bloom filters of
+    // the database, unlike the kernel lookup in the transaction index
+    const CBlockIndex* pindexTip = ::ChainActive().Tip();
+    if (block.hashPrevBlock != pindexTip->GetBlockHash())
+        return true;
+    const COutPoint& prevout = txCoinStake.vin[0].prevout;
+    const Coin& coin = ::ChainstateActive().CoinsTip().AccessCoin(prevout);
+    if (coin.IsSpent())
+        return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-cs-kernel-missing", strprintf("%s : kernel %s is not unspent", __func__, prevout.ToString()));
+    if (nTimeTx < coin.nTime || ::ChainActive()[coin.nHeight]->nTime + Params().GetConsensus().nStakeMinAge > nTimeTx)
+        return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-cs-kernel-immature", strprintf("%s : kernel %s violates the min age", __func__, prevout.ToString()));
+
+    return true;
 }
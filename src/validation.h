@@ -157,9 +157,6 @@ extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
 extern size_t nCoinCacheUsage;
-extern bool fAddressIndex;
-extern bool fSpentIndex;
-extern bool fTimestampIndex;
 extern bool fAlerts;
 /** If the tip is older than this (in seconds), the node is considered to be in initial block download. */
 extern int64_t nMaxTipAge;
@@ -337,8 +334,13 @@ void InitScriptExecutionCache();
 
 bool GetTimestampIndex(const unsigned int& high, const unsigned int& low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int>>& hashes);
 bool GetSpentIndex(CSpentIndexKey& key, CSpentIndexValue& value);
-bool HashOnchainActive(const uint256& hash);
 bool GetAddressIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start = 0, int end = 0);
+//! Read several addresses at once, merged in height order
+bool GetAddressIndex(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex, int start = 0, int end = 0);
+bool GetAddressUnspent(const std::vector<std::pair<uint256, int>>& addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs);
+bool IterateAddressIndex(uint256 addressHash, int type, const std::function<bool(const CAddressIndexKey&, CAmount)>& visitor, const CAddressIndexKey* pkeyAfter = nullptr, bool fDescending = false, int start = 0, int end = 0);
+bool IterateAddressUnspent(uint256 addressHash, int type, const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& visitor, const CAddressUnspentKey* pkeyAfter = nullptr, bool fDescending = false);
+bool GetAddressBalance(uint256 addressHash, int type, CAddressBalance& balance);
 bool GetAddressUnspent(uint256 addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs);
 
 
@@ -789,11 +791,22 @@ bool DumpMempool(const CTxMemPool& pool);
 /** Load the mempool from disk. */
 bool LoadMempool(CTxMemPool& pool);
 
+/** sumcoin: Write the block index snapshot read at the next start. */
+bool DumpBlockIndexSnapshot() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 // sumcoin:
 CAmount GetProofOfWorkReward(unsigned int nBits, uint32_t nTime);
 CAmount GetProofOfStakeReward(int64_t nCoinAge, uint32_t nTime, uint64_t nMoneySupply);
 bool GetCoinAge(const CTransaction& tx, const CCoinsViewCache& view, uint64_t& nCoinAge, unsigned int nTimeTx, bool isTrueCoinAge = true); // sumcoin: get transaction coin age
 bool SignBlock(CBlock& block, const CWallet& keystore);
 bool CheckBlockSignature(const CBlock& block);
+/**
+ * sumcoin: checks of a proof-of-stake block that only need memory, run before
+ * the block is stored or its kernel is looked up on disk: the coinstake
+ * timestamp, the block signature and, for a block extending the tip, that its
+ * kernel is an unspent and old enough output. fDuplicate is set when the stake
+ * was recently used by another block.
+ */
+bool PreCheckProofOfStake(const CBlock& block, BlockValidationState& state, bool& fDuplicate) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 #endif // BITCOIN_VALIDATION_H